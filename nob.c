@@ -6,16 +6,45 @@ int main(int argc, char **argv) {
         NOB_GO_REBUILD_URSELF(argc, argv);
         Nob_Cmd cmd = {0};
 
+        // Opções de build
+        const char *program = nob_shift_args(&argc, &argv);
+        bool computed_goto = true;
+        bool trace = false;
+        while (argc > 0) {
+                const char *option = nob_shift_args(&argc, &argv);
+                if (strcmp(option, "--no-computed-goto") == 0) {
+                        computed_goto = false;
+                } else if (strcmp(option, "--trace") == 0) {
+                        trace = true;
+                } else {
+                        nob_log(NOB_ERROR, "Unknown option: %s", option);
+                        nob_log(NOB_INFO,
+                                "Usage: %s [--no-computed-goto] [--trace]",
+                                program);
+                        return 1;
+                }
+        }
+
         // Create build directory
         if (!nob_mkdir_if_not_exists("bin/"))
                 return 1;
         if (!nob_mkdir_if_not_exists("bin/tests"))
                 return 1;
+        if (!nob_mkdir_if_not_exists("bin/obj"))
+                return 1;
 
         // Basic compiler options
-        nob_cmd_append(&cmd, "cc", "-Wall", "-Wextra", "-o", "bin/c8c");
+        nob_cmd_append(&cmd, "cc", "-Wall", "-Wextra", "-O2", "-o", "bin/c8c");
+        if (!computed_goto)
+                nob_cmd_append(&cmd, "-DNO_COMPUTED_GOTO");
+        // Logs de trace ficam fora do build, a menos que pedidos
+        if (trace)
+                nob_cmd_append(&cmd, "-DLOG_MIN_LEVEL=LOG_LEVEL_TRACE");
         // Files to compile
-        nob_cmd_append(&cmd, "src/main.c", "src/system.c", "src/errors.c");
+        nob_cmd_append(&cmd, "src/main.c", "src/system.c", "src/decode_cache.c",
+                       "src/threaded.c", "src/jit.c", "src/trace.c",
+                       "src/savestate.c", "src/rewind.c", "src/movie.c",
+                       "src/errors.c");
         // SDL3 flags
         nob_cmd_append(&cmd, "-I/usr/local/lib64/pkgconfig/../../include",
                        "-L/usr/local/lib64/pkgconfig/../../lib64",
@@ -24,9 +53,57 @@ int main(int argc, char **argv) {
         if (!nob_cmd_run_sync_and_reset(&cmd))
                 return 1;
 
-        nob_cmd_append(&cmd, "cc", "-Wall", "-Wextra", "-o", "bin/tests/tests");
+        // Núcleo como biblioteca, sem SDL nem logs, para hospedar instâncias
+        // em outros programas: bin/libc8c.a e bin/libc8c.so
+        const char *core[] = {"system",    "decode_cache", "threaded",
+                              "jit",       "trace",        "savestate",
+                              "rewind",    "movie",        "lockstep"};
+        Nob_Cmd objects = {0};
+        for (size_t i = 0; i < NOB_ARRAY_LEN(core); ++i) {
+                const char *object = nob_temp_sprintf("bin/obj/%s.o", core[i]);
+                nob_cmd_append(&cmd, "cc", "-Wall", "-Wextra", "-O2", "-fPIC",
+                               "-DNO_LOGGING", "-c", "-o", object);
+                if (!computed_goto)
+                        nob_cmd_append(&cmd, "-DNO_COMPUTED_GOTO");
+                nob_cmd_append(&cmd, nob_temp_sprintf("src/%s.c", core[i]));
+                if (!nob_cmd_run_sync_and_reset(&cmd))
+                        return 1;
+                nob_cmd_append(&objects, object);
+        }
+        nob_cmd_append(&cmd, "ar", "rcs", "bin/libc8c.a");
+        nob_da_append_many(&cmd, objects.items, objects.count);
+        if (!nob_cmd_run_sync_and_reset(&cmd))
+                return 1;
+        nob_cmd_append(&cmd, "cc", "-shared", "-o", "bin/libc8c.so");
+        nob_da_append_many(&cmd, objects.items, objects.count);
+        nob_cmd_free(objects);
+        if (!nob_cmd_run_sync_and_reset(&cmd))
+                return 1;
+
+        // Execução de muitos jobs em paralelo, ligada à libc8c
+        nob_cmd_append(&cmd, "cc", "-Wall", "-Wextra", "-O2", "-pthread",
+                       "-DNO_LOGGING", "-o", "bin/c8c-batch");
+        if (!computed_goto)
+                nob_cmd_append(&cmd, "-DNO_COMPUTED_GOTO");
+        nob_cmd_append(&cmd, "src/batch.c", "bin/libc8c.a");
+        if (!nob_cmd_run_sync_and_reset(&cmd))
+                return 1;
+
+        // Decodificador de traces, sem SDL
+        nob_cmd_append(&cmd, "cc", "-Wall", "-Wextra", "-O2", "-o",
+                       "bin/c8c-trace", "src/trace_tool.c", "src/trace.c");
+        if (!nob_cmd_run_sync_and_reset(&cmd))
+                return 1;
+
+        nob_cmd_append(&cmd, "cc", "-Wall", "-Wextra", "-O2", "-o",
+                       "bin/tests/tests");
         nob_cmd_append(&cmd, "-DNO_LOGGING");
-        nob_cmd_append(&cmd, "tests/tests.c", "src/system.c");
+        if (!computed_goto)
+                nob_cmd_append(&cmd, "-DNO_COMPUTED_GOTO");
+        nob_cmd_append(&cmd, "tests/tests.c", "src/system.c",
+                       "src/decode_cache.c", "src/threaded.c", "src/jit.c",
+                       "src/trace.c", "src/savestate.c", "src/rewind.c",
+                       "src/movie.c", "src/lockstep.c");
         if (!nob_cmd_run_sync_and_reset(&cmd))
                 return 1;
 
@@ -0,0 +1,361 @@
+/*
+ * c8c-batch: executa muitas combinações de ROM e entrada em paralelo
+ *
+ *   c8c-batch [-j threads] [--ipf N] [-o saída] <manifesto>
+ *
+ * Cada linha do manifesto é um job: `<rom> <seed> <entrada> <ciclos>
+ * [quirks]`, com `-` no lugar da entrada quando não há nenhuma. A seed
+ * alimenta o gerador do CxNN, então o mesmo job sempre produz o mesmo
+ * resultado. O perfil de quirks (`chip8`, `schip` ou `xochip`) é `chip8`
+ * quando omitido. Linhas vazias ou começando com `#` são ignoradas. O
+ * arquivo de entrada tem uma linha por evento, `<ciclo> <teclas>`, com as
+ * teclas pressionadas a partir daquele ciclo como máscara hexadecimal (bit
+ * N = tecla N).
+ */
+#include "system.h"
+#include "threaded.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Instruções por tick dos timers, o mesmo padrão do c8c
+#define BATCH_INSTRUCTIONS_PER_FRAME 8
+
+typedef struct {
+        uint64_t cycle;
+        uint16_t keys;
+} InputEvent;
+
+typedef enum {
+        // Executou todo o orçamento de ciclos
+        STOP_BUDGET,
+        // Parou num salto para o próprio endereço, sem entradas pendentes
+        STOP_HALTED,
+        // Parou esperando uma tecla, sem entradas pendentes
+        STOP_WAITING_KEY,
+        // A ROM falhou; a saída mostra o nome da falha (`fault_name()`)
+        STOP_FAULT,
+} StopReason;
+
+static const char *const STOP_REASON_NAMES[] = {
+    [STOP_BUDGET] = "budget",
+    [STOP_HALTED] = "halted",
+    [STOP_WAITING_KEY] = "waiting_key",
+};
+
+typedef struct {
+        // Entrada, preparada pela thread principal
+        char *rom;
+        uint64_t seed;
+        QuirkProfile quirks;
+        uint64_t max_cycles;
+        uint8_t *program;
+        size_t program_size;
+        InputEvent *events;
+        size_t event_count;
+
+        // Resultado, escrito só pelo worker que executou o job
+        StopReason reason;
+        Fault fault;
+        uint64_t cycles;
+        uint16_t program_counter;
+        uint16_t index_register;
+        uint8_t registers[REGISTER_COUNT];
+        uint64_t display_hash;
+} Job;
+
+// Fila de um worker: o dono pega jobs do fim, os outros roubam do começo
+typedef struct {
+        pthread_mutex_t lock;
+        size_t begin;
+        size_t end;
+} WorkQueue;
+
+typedef struct {
+        Job *jobs;
+        WorkQueue *queues;
+        size_t worker_count;
+        uint32_t instructions_per_frame;
+} Pool;
+
+typedef struct {
+        Pool *pool;
+        size_t id;
+} Worker;
+
+static bool take_own(WorkQueue *queue, size_t *job) {
+        pthread_mutex_lock(&queue->lock);
+        const bool found = queue->begin < queue->end;
+        if (found)
+                *job = --queue->end;
+        pthread_mutex_unlock(&queue->lock);
+        return found;
+}
+
+static bool steal(WorkQueue *queue, size_t *job) {
+        pthread_mutex_lock(&queue->lock);
+        const bool found = queue->begin < queue->end;
+        if (found)
+                *job = queue->begin++;
+        pthread_mutex_unlock(&queue->lock);
+        return found;
+}
+
+static void run_job(Chip8 *chip8, Job *job, uint32_t instructions_per_frame) {
+        set_instructions_per_tick(chip8, instructions_per_frame);
+        set_random_seed(chip8, job->seed);
+        set_quirk_profile(chip8, job->quirks);
+        init(chip8, job->program, job->program_size);
+
+        uint64_t cycles = 0;
+        size_t next_event = 0;
+        job->reason = STOP_BUDGET;
+        while (cycles < job->max_cycles) {
+                while (next_event < job->event_count &&
+                       job->events[next_event].cycle <= cycles) {
+                        chip8->keypad = job->events[next_event].keys;
+                        next_event++;
+                }
+                if (next_event == job->event_count && program_stuck(chip8)) {
+                        // Um 1NNN para si mesmo ou o 00FD não saem mais
+                        job->reason = waiting_for_key(chip8)
+                                          ? STOP_WAITING_KEY
+                                          : STOP_HALTED;
+                        break;
+                }
+
+                // Um quadro por vez, sem passar do próximo evento
+                uint64_t batch = instructions_per_frame;
+                if (job->max_cycles - cycles < batch)
+                        batch = job->max_cycles - cycles;
+                if (next_event < job->event_count &&
+                    job->events[next_event].cycle - cycles < batch)
+                        batch = job->events[next_event].cycle - cycles;
+                cycles += run_threaded(chip8, (uint32_t)batch);
+                if (chip8->trap.fault != FAULT_NONE) {
+                        job->reason = STOP_FAULT;
+                        job->fault = chip8->trap.fault;
+                        break;
+                }
+        }
+
+        job->cycles = cycles;
+        job->program_counter = chip8->program_counter;
+        job->index_register = chip8->index_register;
+        memcpy(job->registers, chip8->registers, REGISTER_COUNT);
+        job->display_hash = display_hash(chip8);
+}
+
+static void *worker_main(void *argument) {
+        Worker *worker = argument;
+        Pool *pool = worker->pool;
+        // Cada worker reaproveita a sua própria máquina entre os jobs
+        Chip8 *chip8 = aligned_alloc(_Alignof(Chip8), sizeof(Chip8));
+        memset(chip8, 0, sizeof(Chip8));
+
+        size_t job;
+        for (;;) {
+                bool found = take_own(&pool->queues[worker->id], &job);
+                for (size_t i = 1; !found && i < pool->worker_count; ++i) {
+                        const size_t victim =
+                            (worker->id + i) % pool->worker_count;
+                        found = steal(&pool->queues[victim], &job);
+                }
+                if (!found)
+                        break;
+                run_job(chip8, &pool->jobs[job],
+                        pool->instructions_per_frame);
+        }
+
+        free(chip8);
+        return NULL;
+}
+
+static uint8_t *read_file(const char *path, size_t max_size, size_t *size) {
+        FILE *file = fopen(path, "rb");
+        if (file == NULL)
+                return NULL;
+        uint8_t *data = malloc(max_size);
+        *size = fread(data, 1, max_size, file);
+        fclose(file);
+        return data;
+}
+
+static bool load_events(Job *job, const char *path) {
+        FILE *file = fopen(path, "r");
+        if (file == NULL)
+                return false;
+
+        size_t capacity = 16;
+        job->events = malloc(capacity * sizeof(InputEvent));
+        job->event_count = 0;
+        unsigned long long cycle;
+        unsigned int keys;
+        while (fscanf(file, "%llu %x", &cycle, &keys) == 2) {
+                if (job->event_count == capacity) {
+                        capacity *= 2;
+                        job->events =
+                            realloc(job->events, capacity * sizeof(InputEvent));
+                }
+                job->events[job->event_count].cycle = cycle;
+                job->events[job->event_count].keys = (uint16_t)keys;
+                job->event_count++;
+        }
+        fclose(file);
+        return true;
+}
+
+// Lê o manifesto e carrega ROMs e entradas antes de iniciar as threads
+static Job *load_manifest(const char *path, size_t *job_count) {
+        FILE *file = fopen(path, "r");
+        if (file == NULL) {
+                fprintf(stderr, "Não foi possível ler o manifesto: %s\n",
+                        path);
+                return NULL;
+        }
+
+        size_t capacity = 64;
+        Job *jobs = malloc(capacity * sizeof(Job));
+        size_t count = 0;
+        char line[4096];
+        size_t line_number = 0;
+        while (fgets(line, sizeof(line), file) != NULL) {
+                line_number++;
+                char rom[1024];
+                char input[1024];
+                char quirks[16] = "chip8";
+                unsigned long long seed;
+                unsigned long long cycles;
+                QuirkProfile profile;
+                if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+                        continue;
+                if (sscanf(line, "%1023s %llu %1023s %llu %15s", rom, &seed,
+                           input, &cycles, quirks) < 4 ||
+                    !parse_quirk_profile(quirks, &profile)) {
+                        fprintf(stderr, "%s:%zu: job inválido\n", path,
+                                line_number);
+                        fclose(file);
+                        return NULL;
+                }
+
+                if (count == capacity) {
+                        capacity *= 2;
+                        jobs = realloc(jobs, capacity * sizeof(Job));
+                }
+                Job *job = &jobs[count++];
+                memset(job, 0, sizeof(*job));
+                job->rom = strdup(rom);
+                job->seed = seed;
+                job->quirks = profile;
+                job->max_cycles = cycles;
+                job->program = read_file(rom, MEMORY_SIZE - PROGRAM_START,
+                                         &job->program_size);
+                if (job->program == NULL) {
+                        fprintf(stderr, "%s:%zu: ROM não encontrada: %s\n",
+                                path, line_number, rom);
+                        fclose(file);
+                        return NULL;
+                }
+                if (strcmp(input, "-") != 0 && !load_events(job, input)) {
+                        fprintf(stderr,
+                                "%s:%zu: entrada não encontrada: %s\n", path,
+                                line_number, input);
+                        fclose(file);
+                        return NULL;
+                }
+        }
+        fclose(file);
+        *job_count = count;
+        return jobs;
+}
+
+static void write_results(FILE *out, const Job *jobs, size_t count) {
+        fprintf(out, "job\trom\tseed\tcycles\treason\tpc\ti\tregisters\t"
+                     "display_hash\n");
+        for (size_t i = 0; i < count; ++i) {
+                const Job *job = &jobs[i];
+                const char *reason = job->reason == STOP_FAULT
+                                         ? fault_name(job->fault)
+                                         : STOP_REASON_NAMES[job->reason];
+                fprintf(out, "%zu\t%s\t%" PRIu64 "\t%" PRIu64 "\t%s\t0x%03X\t"
+                             "0x%03X\t",
+                        i, job->rom, job->seed, job->cycles, reason,
+                        job->program_counter, job->index_register);
+                for (uint8_t r = 0; r < REGISTER_COUNT; ++r) {
+                        fprintf(out, "%02X", job->registers[r]);
+                }
+                fprintf(out, "\t0x%016" PRIX64 "\n", job->display_hash);
+        }
+}
+
+int main(int argc, char *argv[]) {
+        const char *manifest = NULL;
+        const char *output = NULL;
+        long threads = sysconf(_SC_NPROCESSORS_ONLN);
+        uint32_t instructions_per_frame = BATCH_INSTRUCTIONS_PER_FRAME;
+
+        for (int i = 1; i < argc; ++i) {
+                if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+                        threads = strtol(argv[++i], NULL, 0);
+                } else if (strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) {
+                        instructions_per_frame =
+                            (uint32_t)strtoul(argv[++i], NULL, 0);
+                } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+                        output = argv[++i];
+                } else {
+                        manifest = argv[i];
+                }
+        }
+        if (manifest == NULL || instructions_per_frame == 0) {
+                fprintf(stderr,
+                        "Uso: %s [-j threads] [--ipf N] [-o saída] "
+                        "<manifesto>\n",
+                        argv[0]);
+                return EXIT_FAILURE;
+        }
+        if (threads < 1)
+                threads = 1;
+
+        size_t job_count = 0;
+        Job *jobs = load_manifest(manifest, &job_count);
+        if (jobs == NULL)
+                return EXIT_FAILURE;
+
+        // Distribui os jobs em faixas contíguas, uma por worker
+        Pool pool = {
+            .jobs = jobs,
+            .queues = calloc(threads, sizeof(WorkQueue)),
+            .worker_count = (size_t)threads,
+            .instructions_per_frame = instructions_per_frame,
+        };
+        Worker *workers = calloc(threads, sizeof(Worker));
+        pthread_t *handles = calloc(threads, sizeof(pthread_t));
+        for (size_t i = 0; i < pool.worker_count; ++i) {
+                pthread_mutex_init(&pool.queues[i].lock, NULL);
+                pool.queues[i].begin = job_count * i / pool.worker_count;
+                pool.queues[i].end = job_count * (i + 1) / pool.worker_count;
+                workers[i].pool = &pool;
+                workers[i].id = i;
+        }
+        for (size_t i = 0; i < pool.worker_count; ++i) {
+                pthread_create(&handles[i], NULL, worker_main, &workers[i]);
+        }
+        for (size_t i = 0; i < pool.worker_count; ++i) {
+                pthread_join(handles[i], NULL);
+        }
+
+        FILE *out = output != NULL ? fopen(output, "w") : stdout;
+        if (out == NULL) {
+                fprintf(stderr, "Não foi possível criar a saída: %s\n",
+                        output);
+                return EXIT_FAILURE;
+        }
+        write_results(out, jobs, job_count);
+        if (out != stdout)
+                fclose(out);
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,289 @@
+#include "decode_cache.h"
+#include "system.h"
+#include <stdint.h>
+#include <string.h>
+
+// Cada handler executa a instrução e avança o PC, como faz o `step()`
+#define SIMPLE_HANDLER(name, call)                                             \
+        static void name(Chip8 *chip8, const DecodedInstruction *in) {        \
+                (void)in;                                                      \
+                call;                                                          \
+                chip8->program_counter += 2;                                   \
+        }
+
+SIMPLE_HANDLER(op_clear_display, clear_display(chip8))
+SIMPLE_HANDLER(op_scroll_down, scroll_down(chip8, in->last_nibble))
+SIMPLE_HANDLER(op_scroll_right, scroll_right(chip8))
+SIMPLE_HANDLER(op_scroll_left, scroll_left(chip8))
+SIMPLE_HANDLER(op_set_lores, set_hires(chip8, false))
+SIMPLE_HANDLER(op_set_hires, set_hires(chip8, true))
+SIMPLE_HANDLER(op_skip_if_equal, skip_if_equal(chip8, in->v_x, in->second_byte))
+SIMPLE_HANDLER(op_skip_if_not_equal,
+               skip_if_not_equal(chip8, in->v_x, in->second_byte))
+SIMPLE_HANDLER(op_skip_if_equal_registers,
+               skip_if_equal_registers(chip8, in->v_x, in->v_y))
+SIMPLE_HANDLER(op_set_register, set_register(chip8, in->v_x, in->second_byte))
+SIMPLE_HANDLER(op_add_to_register,
+               add_to_register(chip8, in->v_x, in->second_byte))
+SIMPLE_HANDLER(op_copy_register, copy_register(chip8, in->v_x, in->v_y))
+SIMPLE_HANDLER(op_set_or, set_or(chip8, in->v_x, in->v_y))
+SIMPLE_HANDLER(op_set_and, set_and(chip8, in->v_x, in->v_y))
+SIMPLE_HANDLER(op_set_xor, set_xor(chip8, in->v_x, in->v_y))
+SIMPLE_HANDLER(op_set_or_reset_flag,
+               set_or(chip8, in->v_x, in->v_y);
+               reset_flag(chip8))
+SIMPLE_HANDLER(op_set_and_reset_flag,
+               set_and(chip8, in->v_x, in->v_y);
+               reset_flag(chip8))
+SIMPLE_HANDLER(op_set_xor_reset_flag,
+               set_xor(chip8, in->v_x, in->v_y);
+               reset_flag(chip8))
+SIMPLE_HANDLER(op_set_add, set_add(chip8, in->v_x, in->v_y))
+SIMPLE_HANDLER(op_set_sub, set_sub(chip8, in->v_x, in->v_y))
+SIMPLE_HANDLER(op_set_rshift, set_rshift(chip8, in->v_x, in->v_y))
+SIMPLE_HANDLER(op_set_rshift_vx, set_rshift(chip8, in->v_x, in->v_x))
+SIMPLE_HANDLER(op_set_subn, set_subn(chip8, in->v_x, in->v_y))
+SIMPLE_HANDLER(op_set_lshift, set_lshift(chip8, in->v_x, in->v_y))
+SIMPLE_HANDLER(op_set_lshift_vx, set_lshift(chip8, in->v_x, in->v_x))
+SIMPLE_HANDLER(op_skip_if_not_equal_registers,
+               skip_if_not_equal_registers(chip8, in->v_x, in->v_y))
+SIMPLE_HANDLER(op_set_index_register, set_index_register(chip8, in->address))
+SIMPLE_HANDLER(op_set_random_and,
+               set_random_and(chip8, in->v_x, in->second_byte))
+SIMPLE_HANDLER(op_draw_sprite,
+               draw_sprite(chip8, in->v_x, in->v_y, in->last_nibble))
+SIMPLE_HANDLER(op_draw_sprite_clipped,
+               draw_sprite_clipped(chip8, in->v_x, in->v_y, in->last_nibble))
+SIMPLE_HANDLER(op_skip_if_pressed, skip_if_pressed(chip8, in->v_x))
+SIMPLE_HANDLER(op_skip_if_not_pressed, skip_if_not_pressed(chip8, in->v_x))
+SIMPLE_HANDLER(op_load_delay_timer_to_register,
+               load_delay_timer_to_register(chip8, in->v_x))
+SIMPLE_HANDLER(op_set_delay_timer, set_delay_timer(chip8, in->v_x))
+SIMPLE_HANDLER(op_set_sound_timer, set_sound_timer(chip8, in->v_x))
+SIMPLE_HANDLER(op_offset_index_register, offset_index_register(chip8, in->v_x))
+SIMPLE_HANDLER(op_load_sprite_font, load_sprite_font(chip8, in->v_x))
+SIMPLE_HANDLER(op_load_big_sprite_font, load_big_sprite_font(chip8, in->v_x))
+SIMPLE_HANDLER(op_store_bcd, store_bcd(chip8, in->v_x))
+SIMPLE_HANDLER(op_store_registers, store_registers(chip8, in->v_x))
+SIMPLE_HANDLER(op_load_to_registers, load_to_registers(chip8, in->v_x))
+SIMPLE_HANDLER(op_store_registers_increment,
+               store_registers(chip8, in->v_x);
+               increment_index(chip8, in->v_x))
+SIMPLE_HANDLER(op_load_to_registers_increment,
+               load_to_registers(chip8, in->v_x);
+               increment_index(chip8, in->v_x))
+SIMPLE_HANDLER(op_store_rpl_flags, store_rpl_flags(chip8, in->v_x))
+SIMPLE_HANDLER(op_load_rpl_flags, load_rpl_flags(chip8, in->v_x))
+
+static void op_return_from_subroutine(Chip8 *chip8,
+                                      const DecodedInstruction *in) {
+        (void)in;
+        return_from_subroutine(chip8);
+}
+
+static void op_jump_to_address(Chip8 *chip8, const DecodedInstruction *in) {
+        jump_to_address(chip8, in->address);
+}
+
+static void op_call_subroutine(Chip8 *chip8, const DecodedInstruction *in) {
+        call_subroutine(chip8, in->address);
+}
+
+static void op_jump_with_offset(Chip8 *chip8, const DecodedInstruction *in) {
+        jump_with_offset(chip8, in->address, 0);
+}
+
+static void op_jump_with_offset_vx(Chip8 *chip8,
+                                   const DecodedInstruction *in) {
+        jump_with_offset(chip8, in->address, in->v_x);
+}
+
+static void op_load_key_to_register(Chip8 *chip8,
+                                    const DecodedInstruction *in) {
+        const bool advance_pc = load_key_to_register(chip8, in->v_x);
+        chip8->program_counter += 2 * advance_pc;
+}
+
+// Instruções sem handler próprio seguem o caminho do `step()`, que é a
+// referência de comportamento
+static void op_fallback(Chip8 *chip8, const DecodedInstruction *in) {
+        (void)in;
+        execute(chip8);
+}
+
+// Os quirks do perfil são resolvidos aqui, na decodificação: cada variação
+// tem seu handler, sem testes na execução
+static InstructionHandler select_handler(uint8_t first_nibble,
+                                         uint8_t second_byte,
+                                         uint8_t last_nibble, uint8_t quirks) {
+        const bool vf_reset = quirks & QUIRK_VF_RESET;
+        const bool shift_vx = quirks & QUIRK_SHIFT_VX;
+        const bool increment = quirks & QUIRK_MEMORY_INCREMENT;
+
+        switch (first_nibble) {
+        case 0x0:
+                switch (second_byte) {
+                case 0xE0:
+                        return op_clear_display;
+                case 0xEE:
+                        return op_return_from_subroutine;
+                case 0xFB:
+                        return op_scroll_right;
+                case 0xFC:
+                        return op_scroll_left;
+                case 0xFE:
+                        return op_set_lores;
+                case 0xFF:
+                        return op_set_hires;
+                }
+                if ((second_byte & 0xF0) == 0xC0)
+                        return op_scroll_down;
+                break;
+        case 0x1:
+                return op_jump_to_address;
+        case 0x2:
+                return op_call_subroutine;
+        case 0x3:
+                return op_skip_if_equal;
+        case 0x4:
+                return op_skip_if_not_equal;
+        case 0x5:
+                return op_skip_if_equal_registers;
+        case 0x6:
+                return op_set_register;
+        case 0x7:
+                return op_add_to_register;
+        case 0x8:
+                switch (last_nibble) {
+                case 0x0:
+                        return op_copy_register;
+                case 0x1:
+                        return vf_reset ? op_set_or_reset_flag : op_set_or;
+                case 0x2:
+                        return vf_reset ? op_set_and_reset_flag : op_set_and;
+                case 0x3:
+                        return vf_reset ? op_set_xor_reset_flag : op_set_xor;
+                case 0x4:
+                        return op_set_add;
+                case 0x5:
+                        return op_set_sub;
+                case 0x6:
+                        return shift_vx ? op_set_rshift_vx : op_set_rshift;
+                case 0x7:
+                        return op_set_subn;
+                case 0xE:
+                        return shift_vx ? op_set_lshift_vx : op_set_lshift;
+                }
+                break;
+        case 0x9:
+                return op_skip_if_not_equal_registers;
+        case 0xA:
+                return op_set_index_register;
+        case 0xB:
+                return quirks & QUIRK_JUMP_VX ? op_jump_with_offset_vx
+                                              : op_jump_with_offset;
+        case 0xC:
+                return op_set_random_and;
+        case 0xD:
+                return quirks & QUIRK_CLIP ? op_draw_sprite_clipped
+                                           : op_draw_sprite;
+        case 0xE:
+                switch (second_byte) {
+                case 0x9E:
+                        return op_skip_if_pressed;
+                case 0xA1:
+                        return op_skip_if_not_pressed;
+                }
+                break;
+        case 0xF:
+                switch (second_byte) {
+                case 0x07:
+                        return op_load_delay_timer_to_register;
+                case 0x0A:
+                        return op_load_key_to_register;
+                case 0x15:
+                        return op_set_delay_timer;
+                case 0x18:
+                        return op_set_sound_timer;
+                case 0x1E:
+                        return op_offset_index_register;
+                case 0x29:
+                        return op_load_sprite_font;
+                case 0x30:
+                        return op_load_big_sprite_font;
+                case 0x33:
+                        return op_store_bcd;
+                case 0x55:
+                        return increment ? op_store_registers_increment
+                                         : op_store_registers;
+                case 0x65:
+                        return increment ? op_load_to_registers_increment
+                                         : op_load_to_registers;
+                case 0x75:
+                        return op_store_rpl_flags;
+                case 0x85:
+                        return op_load_rpl_flags;
+                }
+                break;
+        }
+        return op_fallback;
+}
+
+static void decode(const Chip8 *chip8, uint16_t address,
+                   DecodedInstruction *entry) {
+        const uint8_t first_byte = chip8->memory[address];
+        const uint8_t second_byte = chip8->memory[address + 1];
+
+        entry->v_x = first_byte & 0x0F;
+        entry->v_y = second_byte >> 4;
+        entry->last_nibble = second_byte & 0x0F;
+        entry->second_byte = second_byte;
+        entry->address = ((uint16_t)(entry->v_x) << 8) | second_byte;
+        entry->handler = select_handler(first_byte >> 4, second_byte,
+                                        entry->last_nibble,
+                                        quirk_flags(chip8->quirks));
+}
+
+static void on_memory_write(void *context, uint16_t address, uint16_t length) {
+        decode_cache_invalidate((DecodeCache *)context, address, length);
+}
+
+void decode_cache_attach(DecodeCache *cache, Chip8 *chip8) {
+        memset(cache->entries, 0, sizeof(cache->entries));
+        chip8->on_memory_write = on_memory_write;
+        chip8->memory_write_context = cache;
+}
+
+void decode_cache_detach(Chip8 *chip8) {
+        chip8->on_memory_write = NULL;
+        chip8->memory_write_context = NULL;
+}
+
+void decode_cache_invalidate(DecodeCache *cache, uint16_t address,
+                             uint16_t length) {
+        // A instrução que começa no byte anterior também lê o byte escrito
+        const uint16_t start = address > 0 ? address - 1 : 0;
+        uint32_t end = (uint32_t)address + length;
+        if (end > MEMORY_SIZE)
+                end = MEMORY_SIZE;
+
+        for (uint32_t i = start; i < end; ++i) {
+                cache->entries[i].handler = NULL;
+        }
+}
+
+Fault step_cached(Chip8 *chip8, DecodeCache *cache) {
+        const uint16_t pc = chip8->program_counter;
+        if (pc >= MEMORY_SIZE - 1 || chip8->trap.fault != FAULT_NONE)
+                return step(chip8);
+
+        DecodedInstruction *entry = &cache->entries[pc];
+        if (entry->handler == NULL)
+                decode(chip8, pc, entry);
+
+        entry->handler(chip8, entry);
+        if (chip8->trap.fault != FAULT_NONE)
+                return chip8->trap.fault;
+        advance_cycles(chip8, 1);
+        return FAULT_NONE;
+}
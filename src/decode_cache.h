@@ -0,0 +1,35 @@
+#include "system.h"
+#include <stdint.h>
+
+#ifndef DECODE_CACHE_H
+#define DECODE_CACHE_H
+
+typedef struct DecodedInstruction DecodedInstruction;
+
+typedef void (*InstructionHandler)(Chip8 *chip8,
+                                   const DecodedInstruction *instruction);
+
+// Instrução decodificada uma única vez, com os operandos já extraídos
+struct DecodedInstruction {
+        InstructionHandler handler;
+        uint16_t address;
+        uint8_t v_x;
+        uint8_t v_y;
+        uint8_t last_nibble;
+        uint8_t second_byte;
+};
+
+// Vetor paralelo à memória: a entrada N corresponde à instrução que começa
+// no endereço N. Entradas sem handler ainda não foram decodificadas.
+typedef struct {
+        DecodedInstruction entries[MEMORY_SIZE];
+} DecodeCache;
+
+void decode_cache_attach(DecodeCache *cache, Chip8 *chip8);
+void decode_cache_detach(Chip8 *chip8);
+void decode_cache_invalidate(DecodeCache *cache, uint16_t address,
+                             uint16_t length);
+// Mesmo contrato do `step()`
+Fault step_cached(Chip8 *chip8, DecodeCache *cache);
+
+#endif
@@ -1,4 +1,7 @@
 #include "errors.h"
+#include "log.h"
+
+bool log_trace_enabled = false;
 
 void log_error(ErrorCode error_code) {
         switch (error_code) {
@@ -27,4 +30,26 @@ void log_error(ErrorCode error_code) {
                 SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unknown error");
                 break;
         }
-};
\ No newline at end of file
+};
+
+void log_trap(const Trap *trap) {
+        switch (trap->fault) {
+        case FAULT_NONE:
+                return;
+        case FAULT_STACK_OVERFLOW:
+                log_error(STACK_OVERFLOW);
+                break;
+        case FAULT_STACK_UNDERFLOW:
+                log_error(STACK_UNDERFLOW);
+                break;
+        case FAULT_INVALID_INSTRUCTION:
+                log_error(INVALID_INSTRUCTION);
+                break;
+        case FAULT_INVALID_ADDRESS:
+                log_error(INVALID_MEMORY_ADDRESS);
+                break;
+        }
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Instância parada em 0x%03X (instrução 0x%04X)",
+                     trap->program_counter, trap->op_code);
+}
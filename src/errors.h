@@ -1,3 +1,4 @@
+#include "system.h"
 #include <SDL3/SDL_log.h>
 
 typedef enum {
@@ -9,4 +10,6 @@ typedef enum {
         INVALID_MEMORY_ADDRESS,
 } ErrorCode;
 
-void log_error(ErrorCode error_code);
\ No newline at end of file
+void log_error(ErrorCode error_code);
+// Descreve a falha que parou a instância
+void log_trap(const Trap *trap);
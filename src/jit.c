@@ -0,0 +1,677 @@
+#include "jit.h"
+#include "system.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#if JIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if JIT_SUPPORTED
+
+// Maior código possível para um bloco, usado para decidir quando o buffer
+// precisa ser esvaziado
+#define JIT_MAX_BLOCK_BYTES 4096
+
+// Registradores x86-64 na numeração usada pela codificação das instruções
+enum {
+        RAX = 0,
+        RCX = 1,
+        RDX = 2,
+        RBX = 3,
+        RBP = 5,
+        RSI = 6,
+        RDI = 7,
+        R8 = 8,
+        R9 = 9,
+        R10 = 10,
+        R11 = 11,
+        R12 = 12,
+        R13 = 13,
+        R14 = 14,
+        R15 = 15,
+};
+
+// Registradores onde V0-VF e I ficam durante um bloco. RAX é temporário,
+// RDI aponta para o Chip8 e RSI guarda o orçamento de instruções.
+static const uint8_t register_pool[] = {RCX, RDX, R8,  R9,  R10, R11,
+                                        RBX, RBP, R12, R13, R14, R15};
+#define POOL_SIZE (sizeof(register_pool) / sizeof(register_pool[0]))
+
+// Índice do registrador I nas máscaras de uso (V0-VF ocupam 0-15)
+#define INDEX_SLOT 16
+#define SLOT_COUNT 17
+
+// Condições usadas com SETcc
+#define CC_BELOW 0x2
+#define CC_NOT_BELOW 0x3
+
+#define OFFSET_REGISTERS offsetof(Chip8, registers)
+#define OFFSET_INDEX offsetof(Chip8, index_register)
+#define OFFSET_PC offsetof(Chip8, program_counter)
+#define OFFSET_DELAY offsetof(Chip8, delay_timer)
+#define OFFSET_SOUND offsetof(Chip8, sound_timer)
+
+typedef struct {
+        uint8_t *code;
+        size_t size;
+} Emitter;
+
+static void emit8(Emitter *e, uint8_t byte) { e->code[e->size++] = byte; }
+
+static void emit16(Emitter *e, uint16_t value) {
+        emit8(e, value & 0xFF);
+        emit8(e, value >> 8);
+}
+
+static void emit32(Emitter *e, uint32_t value) {
+        emit16(e, value & 0xFFFF);
+        emit16(e, value >> 16);
+}
+
+// Prefixo REX sempre presente, para que SIL/BPL não virem DH/CH em operações
+// de 8 bits
+static void emit_rex(Emitter *e, uint8_t reg, uint8_t rm) {
+        emit8(e, 0x40 | ((reg >> 3) << 2) | (rm >> 3));
+}
+
+static void emit_modrm_direct(Emitter *e, uint8_t reg, uint8_t rm) {
+        emit8(e, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// [rdi + disp32]
+static void emit_modrm_chip8(Emitter *e, uint8_t reg, uint32_t offset) {
+        emit8(e, 0x80 | ((reg & 7) << 3) | RDI);
+        emit32(e, offset);
+}
+
+// op r/m8, r8 (mov, add, or, and, xor, sub)
+static void emit_byte_op(Emitter *e, uint8_t opcode, uint8_t dst,
+                         uint8_t src) {
+        emit_rex(e, src, dst);
+        emit8(e, opcode);
+        emit_modrm_direct(e, src, dst);
+}
+
+// op r/m8, imm8 do grupo 0x80 (add = /0, cmp = /7)
+static void emit_byte_op_imm(Emitter *e, uint8_t extension, uint8_t dst,
+                             uint8_t value) {
+        emit_rex(e, 0, dst);
+        emit8(e, 0x80);
+        emit_modrm_direct(e, extension, dst);
+        emit8(e, value);
+}
+
+static void emit_mov_byte_imm(Emitter *e, uint8_t dst, uint8_t value) {
+        emit_rex(e, 0, dst);
+        emit8(e, 0xB0 + (dst & 7));
+        emit8(e, value);
+}
+
+// Deslocamento de 1 bit do grupo 0xD0 (shl = /4, shr = /5)
+static void emit_byte_shift(Emitter *e, uint8_t extension, uint8_t dst) {
+        emit_rex(e, 0, dst);
+        emit8(e, 0xD0);
+        emit_modrm_direct(e, extension, dst);
+}
+
+static void emit_setcc(Emitter *e, uint8_t condition, uint8_t dst) {
+        emit_rex(e, 0, dst);
+        emit8(e, 0x0F);
+        emit8(e, 0x90 | condition);
+        emit_modrm_direct(e, 0, dst);
+}
+
+static void emit_load_byte(Emitter *e, uint8_t dst, uint32_t offset) {
+        emit_rex(e, dst, 0);
+        emit8(e, 0x8A);
+        emit_modrm_chip8(e, dst, offset);
+}
+
+static void emit_store_byte(Emitter *e, uint8_t src, uint32_t offset) {
+        emit_rex(e, src, 0);
+        emit8(e, 0x88);
+        emit_modrm_chip8(e, src, offset);
+}
+
+static void emit_load_word(Emitter *e, uint8_t dst, uint32_t offset) {
+        emit_rex(e, dst, 0);
+        emit8(e, 0x0F);
+        emit8(e, 0xB7);
+        emit_modrm_chip8(e, dst, offset);
+}
+
+static void emit_store_word(Emitter *e, uint8_t src, uint32_t offset) {
+        emit8(e, 0x66);
+        emit_rex(e, src, 0);
+        emit8(e, 0x89);
+        emit_modrm_chip8(e, src, offset);
+}
+
+static void emit_movzx_byte(Emitter *e, uint8_t dst, uint8_t src) {
+        emit_rex(e, dst, src);
+        emit8(e, 0x0F);
+        emit8(e, 0xB6);
+        emit_modrm_direct(e, dst, src);
+}
+
+// op r/m32, r32 (add = 0x01, mov = 0x89)
+static void emit_dword_op(Emitter *e, uint8_t opcode, uint8_t dst,
+                          uint8_t src) {
+        emit_rex(e, src, dst);
+        emit8(e, opcode);
+        emit_modrm_direct(e, src, dst);
+}
+
+static void emit_mov_dword_imm(Emitter *e, uint8_t dst, uint32_t value) {
+        emit_rex(e, 0, dst);
+        emit8(e, 0xB8 + (dst & 7));
+        emit32(e, value);
+}
+
+static void emit_add_dword_imm(Emitter *e, uint8_t dst, uint32_t value) {
+        emit_rex(e, 0, dst);
+        emit8(e, 0x81);
+        emit_modrm_direct(e, 0, dst);
+        emit32(e, value);
+}
+
+static void emit_shl_dword_imm(Emitter *e, uint8_t dst, uint8_t count) {
+        emit_rex(e, 0, dst);
+        emit8(e, 0xC1);
+        emit_modrm_direct(e, 4, dst);
+        emit8(e, count);
+}
+
+static void emit_push(Emitter *e, uint8_t reg) {
+        if (reg >= 8)
+                emit8(e, 0x41);
+        emit8(e, 0x50 + (reg & 7));
+}
+
+static void emit_pop(Emitter *e, uint8_t reg) {
+        if (reg >= 8)
+                emit8(e, 0x41);
+        emit8(e, 0x58 + (reg & 7));
+}
+
+static bool is_callee_saved(uint8_t reg) {
+        return reg == RBX || reg == RBP || reg >= R12;
+}
+
+// Diz se a instrução pode ser traduzida e quais slots (V0-VF, I) ela lê ou
+// escreve. Saltos, skips, Dxyn, Fx0A e acessos à memória encerram o bloco e
+// são executados pelo `step()`. Os quirks do perfil entram na tradução, então
+// o código gerado não os testa.
+static bool analyze(uint8_t first_byte, uint8_t second_byte, uint8_t quirks,
+                    uint32_t *uses, uint32_t *writes) {
+        const uint8_t x = first_byte & 0x0F;
+        const uint8_t y = second_byte >> 4;
+        const uint32_t vx = 1u << x;
+        const uint32_t vy = 1u << y;
+        const uint32_t vf = 1u << 0xF;
+        const uint32_t index = 1u << INDEX_SLOT;
+
+        switch (first_byte >> 4) {
+        case 0x6:
+        case 0x7:
+                *uses = vx;
+                *writes = vx;
+                return true;
+        case 0x8:
+                switch (second_byte & 0x0F) {
+                case 0x0:
+                        *uses = vx | vy;
+                        *writes = vx;
+                        return true;
+                case 0x1:
+                case 0x2:
+                case 0x3:
+                        if (quirks & QUIRK_VF_RESET) {
+                                *uses = vx | vy | vf;
+                                *writes = vx | vf;
+                        } else {
+                                *uses = vx | vy;
+                                *writes = vx;
+                        }
+                        return true;
+                case 0x4:
+                case 0x5:
+                case 0x7:
+                        *uses = vx | vy | vf;
+                        *writes = vx | vf;
+                        return true;
+                case 0x6:
+                case 0xE:
+                        *uses = vx | vf | (quirks & QUIRK_SHIFT_VX ? 0 : vy);
+                        *writes = vx | vf;
+                        return true;
+                }
+                return false;
+        case 0xA:
+                *uses = index;
+                *writes = index;
+                return true;
+        case 0xF:
+                switch (second_byte) {
+                case 0x07:
+                        *uses = vx;
+                        *writes = vx;
+                        return true;
+                case 0x15:
+                case 0x18:
+                        *uses = vx;
+                        *writes = 0;
+                        return true;
+                case 0x1E:
+                case 0x29:
+                        *uses = vx | index;
+                        *writes = index;
+                        return true;
+                }
+                return false;
+        }
+        return false;
+}
+
+static void emit_instruction(Emitter *e, const int8_t host[SLOT_COUNT],
+                             uint8_t first_byte, uint8_t second_byte,
+                             uint8_t quirks) {
+        const uint8_t rx = host[first_byte & 0x0F];
+        const uint8_t ry = host[second_byte >> 4];
+        const uint8_t rf = host[0xF];
+        const uint8_t ri = host[INDEX_SLOT];
+        const uint16_t address = ((uint16_t)(first_byte & 0x0F) << 8) |
+                                 second_byte;
+
+        switch (first_byte >> 4) {
+        case 0x6:
+                emit_mov_byte_imm(e, rx, second_byte);
+                break;
+        case 0x7:
+                emit_byte_op_imm(e, 0, rx, second_byte);
+                break;
+        case 0x8:
+                switch (second_byte & 0x0F) {
+                case 0x0:
+                        emit_byte_op(e, 0x88, rx, ry);
+                        break;
+                case 0x1:
+                        emit_byte_op(e, 0x08, rx, ry);
+                        if (quirks & QUIRK_VF_RESET)
+                                emit_mov_byte_imm(e, rf, 0);
+                        break;
+                case 0x2:
+                        emit_byte_op(e, 0x20, rx, ry);
+                        if (quirks & QUIRK_VF_RESET)
+                                emit_mov_byte_imm(e, rf, 0);
+                        break;
+                case 0x3:
+                        emit_byte_op(e, 0x30, rx, ry);
+                        if (quirks & QUIRK_VF_RESET)
+                                emit_mov_byte_imm(e, rf, 0);
+                        break;
+                case 0x4:
+                        emit_byte_op(e, 0x00, rx, ry);
+                        emit_setcc(e, CC_BELOW, rf);
+                        break;
+                case 0x5:
+                        emit_byte_op(e, 0x28, rx, ry);
+                        emit_setcc(e, CC_NOT_BELOW, rf);
+                        break;
+                case 0x6:
+                        // VX = VY >> 1; o bit que sai fica no carry
+                        if (!(quirks & QUIRK_SHIFT_VX))
+                                emit_byte_op(e, 0x88, rx, ry);
+                        emit_byte_shift(e, 5, rx);
+                        emit_setcc(e, CC_BELOW, rf);
+                        break;
+                case 0x7:
+                        emit_byte_op(e, 0x88, RAX, ry);
+                        emit_byte_op(e, 0x28, RAX, rx);
+                        emit_byte_op(e, 0x88, rx, RAX);
+                        emit_setcc(e, CC_NOT_BELOW, rf);
+                        break;
+                case 0xE:
+                        if (!(quirks & QUIRK_SHIFT_VX))
+                                emit_byte_op(e, 0x88, rx, ry);
+                        emit_byte_shift(e, 4, rx);
+                        emit_setcc(e, CC_BELOW, rf);
+                        break;
+                }
+                break;
+        case 0xA:
+                emit_mov_dword_imm(e, ri, address);
+                break;
+        case 0xF:
+                switch (second_byte) {
+                case 0x07:
+                        emit_load_byte(e, rx, OFFSET_DELAY);
+                        break;
+                case 0x15:
+                        emit_store_byte(e, rx, OFFSET_DELAY);
+                        break;
+                case 0x18:
+                        emit_store_byte(e, rx, OFFSET_SOUND);
+                        break;
+                case 0x1E:
+                        emit_movzx_byte(e, RAX, rx);
+                        emit_dword_op(e, 0x01, ri, RAX);
+                        break;
+                case 0x29:
+                        // I = FONTSET_START + Vx * 5
+                        emit_movzx_byte(e, ri, rx);
+                        emit_dword_op(e, 0x89, RAX, ri);
+                        emit_shl_dword_imm(e, ri, 2);
+                        emit_dword_op(e, 0x01, ri, RAX);
+                        if (FONTSET_START != 0)
+                                emit_add_dword_imm(e, ri, FONTSET_START);
+                        break;
+                }
+                break;
+        }
+}
+
+static void cover(JitCache *cache, uint16_t start, uint16_t length) {
+        for (uint16_t i = start; i < start + length && i < MEMORY_SIZE; ++i) {
+                cache->coverage[i]++;
+        }
+}
+
+static void uncover(JitCache *cache, uint16_t start, uint16_t length) {
+        for (uint16_t i = start; i < start + length && i < MEMORY_SIZE; ++i) {
+                cache->coverage[i]--;
+        }
+}
+
+static void flush(JitCache *cache) {
+        memset(cache->blocks, 0, sizeof(cache->blocks));
+        memset(cache->coverage, 0, sizeof(cache->coverage));
+        cache->code_used = 0;
+}
+
+// W^X: o buffer é executável e só as páginas do bloco sendo emitido ficam
+// graváveis, e só durante a emissão. Nenhuma página é as duas coisas.
+static bool protect_code(JitCache *cache, size_t offset, size_t size,
+                         int protection) {
+        const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        const size_t begin = offset & ~(page - 1);
+        size_t end = (offset + size + page - 1) & ~(page - 1);
+        if (end > JIT_CODE_SIZE)
+                end = JIT_CODE_SIZE;
+        return mprotect(cache->code_buffer + begin, end - begin,
+                        protection) == 0;
+}
+
+// A instrução no início do bloco passa a rodar pelo `step()`
+static void interpret_block(JitCache *cache, uint16_t start) {
+        JitBlock *block = &cache->blocks[start];
+        block->state = JIT_BLOCK_INTERPRET;
+        block->length = 2;
+        cover(cache, start, block->length);
+}
+
+static void compile_block(JitCache *cache, const Chip8 *chip8,
+                          uint16_t start) {
+        int8_t host[SLOT_COUNT];
+        memset(host, -1, sizeof(host));
+        uint8_t allocated = 0;
+        uint32_t dirty = 0;
+        uint16_t count = 0;
+        uint16_t pc = start;
+        const uint8_t quirks = quirk_flags(chip8->quirks);
+
+        // Primeira passada: delimita o bloco e aloca registradores
+        while (count < JIT_MAX_BLOCK_INSTRUCTIONS && pc < MEMORY_SIZE - 1) {
+                uint32_t uses;
+                uint32_t writes;
+                if (!analyze(chip8->memory[pc], chip8->memory[pc + 1], quirks,
+                             &uses, &writes))
+                        break;
+
+                uint8_t needed = 0;
+                for (uint8_t slot = 0; slot < SLOT_COUNT; ++slot) {
+                        needed += ((uses >> slot) & 1) && host[slot] < 0;
+                }
+                if (allocated + needed > POOL_SIZE)
+                        break;
+                for (uint8_t slot = 0; slot < SLOT_COUNT; ++slot) {
+                        if (((uses >> slot) & 1) && host[slot] < 0)
+                                host[slot] = register_pool[allocated++];
+                }
+
+                dirty |= writes;
+                count++;
+                pc += 2;
+        }
+
+        JitBlock *block = &cache->blocks[start];
+        if (count == 0) {
+                interpret_block(cache, start);
+                return;
+        }
+
+        if (JIT_CODE_SIZE - cache->code_used < JIT_MAX_BLOCK_BYTES)
+                flush(cache);
+        if (!protect_code(cache, cache->code_used, JIT_MAX_BLOCK_BYTES,
+                          PROT_READ | PROT_WRITE)) {
+                interpret_block(cache, start);
+                return;
+        }
+
+        Emitter e = {cache->code_buffer + cache->code_used, 0};
+
+        // Prólogo: salva os registradores callee-saved e carrega o estado
+        for (uint8_t i = 0; i < allocated; ++i) {
+                if (is_callee_saved(register_pool[i]))
+                        emit_push(&e, register_pool[i]);
+        }
+        for (uint8_t slot = 0; slot < REGISTER_COUNT; ++slot) {
+                if (host[slot] >= 0)
+                        emit_load_byte(&e, host[slot], OFFSET_REGISTERS + slot);
+        }
+        if (host[INDEX_SLOT] >= 0)
+                emit_load_word(&e, host[INDEX_SLOT], OFFSET_INDEX);
+
+        // Corpo: antes de cada instrução (exceto a primeira) confere se ainda
+        // há orçamento, saltando para o epílogo caso contrário
+        size_t exit_jumps[JIT_MAX_BLOCK_INSTRUCTIONS];
+        for (uint16_t i = 0; i < count; ++i) {
+                if (i > 0) {
+                        // cmp esi, i; jbe epílogo
+                        emit8(&e, 0x83);
+                        emit_modrm_direct(&e, 7, RSI);
+                        emit8(&e, i);
+                        emit8(&e, 0x0F);
+                        emit8(&e, 0x86);
+                        exit_jumps[i] = e.size;
+                        emit32(&e, 0);
+                }
+                const uint16_t address = start + 2 * i;
+                emit_instruction(&e, host, chip8->memory[address],
+                                 chip8->memory[address + 1], quirks);
+        }
+
+        // Epílogo: grava os registradores alterados, calcula quantas
+        // instruções rodaram e atualiza o PC
+        const size_t epilogue = e.size;
+        for (uint16_t i = 1; i < count; ++i) {
+                const int32_t relative = epilogue - (exit_jumps[i] + 4);
+                memcpy(&e.code[exit_jumps[i]], &relative, sizeof(relative));
+        }
+        for (uint8_t slot = 0; slot < REGISTER_COUNT; ++slot) {
+                if ((dirty >> slot) & 1)
+                        emit_store_byte(&e, host[slot],
+                                        OFFSET_REGISTERS + slot);
+        }
+        if ((dirty >> INDEX_SLOT) & 1)
+                emit_store_word(&e, host[INDEX_SLOT], OFFSET_INDEX);
+
+        // eax = min(count, budget)
+        emit_mov_dword_imm(&e, RAX, count);
+        emit_dword_op(&e, 0x39, RSI, RAX);
+        emit8(&e, 0x0F);
+        emit8(&e, 0x42);
+        emit_modrm_direct(&e, RAX, RSI);
+        // ecx = start + eax * 2; PC = cx
+        emit8(&e, 0x8D);
+        emit8(&e, 0x0C);
+        emit8(&e, 0x45);
+        emit32(&e, start);
+        emit8(&e, 0x66);
+        emit8(&e, 0x89);
+        emit_modrm_chip8(&e, RCX, OFFSET_PC);
+
+        for (int8_t i = allocated - 1; i >= 0; --i) {
+                if (is_callee_saved(register_pool[i]))
+                        emit_pop(&e, register_pool[i]);
+        }
+        emit8(&e, 0xC3);
+
+        // As mesmas páginas voltam a ser executáveis; sem isso, nem os
+        // blocos anteriores nelas podem rodar
+        if (!protect_code(cache, cache->code_used, JIT_MAX_BLOCK_BYTES,
+                          PROT_READ | PROT_EXEC)) {
+                flush(cache);
+                interpret_block(cache, start);
+                return;
+        }
+
+        block->code = (JitCode)(void *)(cache->code_buffer + cache->code_used);
+        block->instruction_count = count;
+        block->length = 2 * count;
+        block->state = JIT_BLOCK_COMPILED;
+        cover(cache, start, block->length);
+        cache->code_used += e.size;
+}
+
+static void on_memory_write(void *context, uint16_t address, uint16_t length) {
+        jit_invalidate((JitCache *)context, address, length);
+}
+
+bool jit_attach(JitCache *cache, Chip8 *chip8) {
+        // Nunca gravável e executável ao mesmo tempo: mapeado só para
+        // leitura e escrita, e executável a partir daqui
+        void *buffer = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffer == MAP_FAILED) {
+                cache->code_buffer = NULL;
+                return false;
+        }
+        cache->code_buffer = buffer;
+        if (!protect_code(cache, 0, JIT_CODE_SIZE, PROT_READ | PROT_EXEC)) {
+                munmap(buffer, JIT_CODE_SIZE);
+                cache->code_buffer = NULL;
+                return false;
+        }
+
+        flush(cache);
+        chip8->on_memory_write = on_memory_write;
+        chip8->memory_write_context = cache;
+        return true;
+}
+
+void jit_detach(JitCache *cache, Chip8 *chip8) {
+        if (cache->code_buffer != NULL)
+                munmap(cache->code_buffer, JIT_CODE_SIZE);
+        cache->code_buffer = NULL;
+        chip8->on_memory_write = NULL;
+        chip8->memory_write_context = NULL;
+}
+
+void jit_invalidate(JitCache *cache, uint16_t address, uint16_t length) {
+        uint32_t end = (uint32_t)address + length;
+        if (end > MEMORY_SIZE)
+                end = MEMORY_SIZE;
+
+        bool translated = false;
+        for (uint32_t i = address; i < end; ++i) {
+                translated |= cache->coverage[i] > 0;
+        }
+        if (!translated)
+                return;
+
+        // Um bloco que cobre o endereço começa no máximo um bloco antes dele
+        const uint32_t first = address > 2 * JIT_MAX_BLOCK_INSTRUCTIONS
+                                   ? address - 2 * JIT_MAX_BLOCK_INSTRUCTIONS
+                                   : 0;
+        for (uint32_t start = first; start < end; ++start) {
+                JitBlock *block = &cache->blocks[start];
+                if (block->state != JIT_BLOCK_UNKNOWN &&
+                    start + block->length > address) {
+                        uncover(cache, start, block->length);
+                        block->state = JIT_BLOCK_UNKNOWN;
+                }
+        }
+}
+
+uint32_t run_jit(Chip8 *chip8, JitCache *cache, uint32_t max_instructions) {
+        uint32_t executed = 0;
+        while (executed < max_instructions &&
+               chip8->trap.fault == FAULT_NONE) {
+                const uint16_t pc = chip8->program_counter;
+                if (cache->code_buffer == NULL || pc >= MEMORY_SIZE - 1) {
+                        executed += step(chip8) == FAULT_NONE;
+                        continue;
+                }
+
+                // Laços de espera vão direto até o próximo tick
+                const uint32_t idle = skip_idle_loop(
+                    chip8,
+                    instructions_before_tick(chip8, max_instructions - executed));
+                if (idle > 0) {
+                        advance_cycles(chip8, idle);
+                        executed += idle;
+                        continue;
+                }
+
+                JitBlock *block = &cache->blocks[pc];
+                if (block->state == JIT_BLOCK_UNKNOWN)
+                        compile_block(cache, chip8, pc);
+
+                if (block->state == JIT_BLOCK_COMPILED) {
+                        // O bloco para antes do próximo tick dos timers, para
+                        // que Fx07 leia o mesmo valor que no `step()`
+                        const uint32_t budget = instructions_before_tick(
+                            chip8, max_instructions - executed);
+                        const uint32_t count = block->code(chip8, budget);
+                        advance_cycles(chip8, count);
+                        executed += count;
+                } else {
+                        executed += step(chip8) == FAULT_NONE;
+                }
+        }
+        return executed;
+}
+
+#else
+
+bool jit_attach(JitCache *cache, Chip8 *chip8) {
+        (void)chip8;
+        cache->code_buffer = NULL;
+        return false;
+}
+
+void jit_detach(JitCache *cache, Chip8 *chip8) {
+        (void)cache;
+        (void)chip8;
+}
+
+void jit_invalidate(JitCache *cache, uint16_t address, uint16_t length) {
+        (void)cache;
+        (void)address;
+        (void)length;
+}
+
+uint32_t run_jit(Chip8 *chip8, JitCache *cache, uint32_t max_instructions) {
+        (void)cache;
+        for (uint32_t i = 0; i < max_instructions; ++i) {
+                if (step(chip8) != FAULT_NONE)
+                        return i;
+        }
+        return max_instructions;
+}
+
+#endif
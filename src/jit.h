@@ -0,0 +1,61 @@
+#include "system.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef JIT_H
+#define JIT_H
+
+// O JIT só gera código para x86-64 em sistemas com mmap; nos demais o
+// `run_jit()` recai no `step()`
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__) ||        \
+                            defined(__FreeBSD__))
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+// Tamanho máximo de um bloco básico, em instruções
+#define JIT_MAX_BLOCK_INSTRUCTIONS 64
+// Tamanho do buffer de código executável
+#define JIT_CODE_SIZE (1024 * 1024)
+
+typedef enum {
+        // Ainda não analisado
+        JIT_BLOCK_UNKNOWN,
+        // A instrução no endereço não é traduzida; executa via `step()`
+        JIT_BLOCK_INTERPRET,
+        JIT_BLOCK_COMPILED,
+} JitBlockState;
+
+// O código gerado recebe o orçamento de instruções e retorna quantas
+// executou, saindo no meio do bloco quando o orçamento acaba
+typedef uint32_t (*JitCode)(Chip8 *chip8, uint32_t budget);
+
+typedef struct {
+        JitCode code;
+        uint16_t instruction_count;
+        // Quantidade de bytes da memória do Chip8 cobertos pelo bloco
+        uint16_t length;
+        uint8_t state;
+} JitBlock;
+
+// Blocos indexados pelo endereço inicial. `coverage` conta quantos blocos
+// cobrem cada byte da memória, para invalidar só quando uma escrita atinge
+// código traduzido.
+typedef struct {
+        uint8_t *code_buffer;
+        size_t code_used;
+        JitBlock blocks[MEMORY_SIZE];
+        uint8_t coverage[MEMORY_SIZE];
+} JitCache;
+
+bool jit_attach(JitCache *cache, Chip8 *chip8);
+void jit_detach(JitCache *cache, Chip8 *chip8);
+void jit_invalidate(JitCache *cache, uint16_t address, uint16_t length);
+// Executa até `max_instructions` instruções, traduzindo blocos básicos sob
+// demanda, e retorna quantas foram executadas. Para antes se a instância
+// falhar (`chip8->trap`).
+uint32_t run_jit(Chip8 *chip8, JitCache *cache, uint32_t max_instructions);
+
+#endif
@@ -0,0 +1,372 @@
+#include "lockstep.h"
+#include <string.h>
+
+// Com as extensões vetoriais do GCC/Clang, cada operação sobre as instâncias
+// vira uma instrução SSE2 (ou AVX2, compilando com -mavx2)
+#if defined(__GNUC__) && !defined(NO_LOCKSTEP_VECTORS)
+#define USE_LOCKSTEP_VECTORS 1
+#else
+#define USE_LOCKSTEP_VECTORS 0
+#endif
+
+static void load_lane(Lockstep *lockstep, uint32_t lane) {
+        Chip8 *chip8 = &lockstep->machines[lane];
+        for (uint8_t i = 0; i < REGISTER_COUNT; ++i) {
+                chip8->registers[i] = lockstep->registers[i][lane];
+        }
+        chip8->index_register = lockstep->index_register[lane];
+        chip8->program_counter = lockstep->program_counter[lane];
+        chip8->delay_timer = lockstep->delay_timer[lane];
+        chip8->sound_timer = lockstep->sound_timer[lane];
+}
+
+static void store_lane(Lockstep *lockstep, uint32_t lane) {
+        const Chip8 *chip8 = &lockstep->machines[lane];
+        for (uint8_t i = 0; i < REGISTER_COUNT; ++i) {
+                lockstep->registers[i][lane] = chip8->registers[i];
+        }
+        lockstep->index_register[lane] = chip8->index_register;
+        lockstep->program_counter[lane] = chip8->program_counter;
+        lockstep->delay_timer[lane] = chip8->delay_timer;
+        lockstep->sound_timer[lane] = chip8->sound_timer;
+}
+
+// Caminho escalar: a instância executa sozinha, com a mesma semântica do
+// `step()`
+static void execute_lane(Lockstep *lockstep, uint32_t lane) {
+        Chip8 *chip8 = &lockstep->machines[lane];
+        load_lane(lockstep, lane);
+        execute(chip8);
+        store_lane(lockstep, lane);
+
+        // A instância parada guarda o relógio do momento da falha; os
+        // registradores já estão em `chip8`
+        if (chip8->trap.fault != FAULT_NONE) {
+                chip8->instructions_until_tick =
+                    lockstep->instructions_until_tick;
+                chip8->cycle_count = lockstep->cycle_count;
+        }
+}
+
+#if USE_LOCKSTEP_VECTORS
+
+typedef uint8_t LaneBytes __attribute__((vector_size(LOCKSTEP_LANES)));
+typedef int8_t LaneMask __attribute__((vector_size(LOCKSTEP_LANES)));
+typedef uint16_t LaneWords __attribute__((vector_size(2 * LOCKSTEP_LANES)));
+typedef int16_t LaneWordMask
+    __attribute__((vector_size(2 * LOCKSTEP_LANES)));
+
+// Macros no lugar de funções: passar vetores de 32 ou 64 bytes por valor
+// gera avisos de ABI quando não há registradores desse tamanho
+
+// Cargas e escritas via memcpy, que viram movimentos sem exigir alinhamento
+#define LOAD_LANES(type, source)                                               \
+        ({                                                                     \
+                type value_;                                                   \
+                memcpy(&value_, (source), sizeof(value_));                     \
+                value_;                                                        \
+        })
+
+// Escreve `value` só nas instâncias do grupo
+#define STORE_LANES(type, target, value, mask)                                 \
+        do {                                                                   \
+                type merged_;                                                  \
+                memcpy(&merged_, (target), sizeof(merged_));                   \
+                merged_ = ((value) & (mask)) | (merged_ & ~(mask));            \
+                memcpy((target), &merged_, sizeof(merged_));                   \
+        } while (0)
+
+#define LOAD_BYTES(source) LOAD_LANES(LaneBytes, source)
+#define LOAD_WORDS(source) LOAD_LANES(LaneWords, source)
+#define STORE_BYTES(target, value, mask)                                       \
+        STORE_LANES(LaneBytes, target, value, mask)
+#define STORE_WORDS(target, value, mask)                                       \
+        STORE_LANES(LaneWords, target, value, mask)
+
+// 1 onde a condição vale, 0 no resto
+#define FLAG(condition) ((LaneBytes)(condition) & 1)
+
+#define WIDEN(value) __builtin_convertvector((value), LaneWords)
+
+// Executa a instrução em todas as instâncias do grupo de uma vez, com os
+// quirks do perfil delas. Falso se a instrução não tem versão vetorial.
+static bool execute_group(Lockstep *lockstep, uint8_t first_byte,
+                          uint8_t second_byte, uint32_t group,
+                          uint8_t quirks) {
+        const uint8_t v_x = first_byte & 0x0F;
+        const uint8_t v_y = second_byte >> 4;
+        const uint8_t last_nibble = second_byte & 0x0F;
+        const uint16_t address = ((uint16_t)v_x << 8) | second_byte;
+
+        if (lockstep->mask_group != group) {
+                for (uint32_t lane = 0; lane < LOCKSTEP_LANES; ++lane) {
+                        lockstep->mask[lane] = -(int8_t)((group >> lane) & 1);
+                }
+                lockstep->mask_group = group;
+        }
+        LaneMask lane_mask;
+        memcpy(&lane_mask, lockstep->mask, sizeof(lane_mask));
+        const LaneBytes mask = (LaneBytes)lane_mask;
+        const LaneWords word_mask =
+            (LaneWords)__builtin_convertvector(lane_mask, LaneWordMask);
+
+        uint8_t(*registers)[LOCKSTEP_LANES] = lockstep->registers;
+        const LaneBytes x = LOAD_BYTES(registers[v_x]);
+        const LaneBytes y = LOAD_BYTES(registers[v_y]);
+        const LaneWords program_counter =
+            LOAD_WORDS(lockstep->program_counter);
+        LaneWords next = program_counter + 2;
+
+        switch (first_byte >> 4) {
+        case 0x1:
+                next = (LaneWords){0} + address;
+                break;
+        case 0x3:
+                next += WIDEN(FLAG(x == second_byte)) * 2;
+                break;
+        case 0x4:
+                next += WIDEN(FLAG(x != second_byte)) * 2;
+                break;
+        case 0x5:
+                next += WIDEN(FLAG(x == y)) * 2;
+                break;
+        case 0x6:
+                STORE_BYTES(registers[v_x], (LaneBytes){0} + second_byte,
+                            mask);
+                break;
+        case 0x7:
+                STORE_BYTES(registers[v_x], x + second_byte, mask);
+                break;
+        case 0x8: {
+                // VF é escrito depois do resultado, como no `step()`
+                const LaneBytes shifted = quirks & QUIRK_SHIFT_VX ? x : y;
+                switch (last_nibble) {
+                case 0x0:
+                        STORE_BYTES(registers[v_x], y, mask);
+                        break;
+                case 0x1:
+                        STORE_BYTES(registers[v_x], x | y, mask);
+                        break;
+                case 0x2:
+                        STORE_BYTES(registers[v_x], x & y, mask);
+                        break;
+                case 0x3:
+                        STORE_BYTES(registers[v_x], x ^ y, mask);
+                        break;
+                case 0x4: {
+                        const LaneBytes sum = x + y;
+                        STORE_BYTES(registers[v_x], sum, mask);
+                        STORE_BYTES(registers[0xF], FLAG(sum < x), mask);
+                        break;
+                }
+                case 0x5:
+                        STORE_BYTES(registers[v_x], x - y, mask);
+                        STORE_BYTES(registers[0xF], FLAG(x >= y), mask);
+                        break;
+                case 0x6:
+                        STORE_BYTES(registers[v_x], shifted >> 1, mask);
+                        STORE_BYTES(registers[0xF], shifted & 1, mask);
+                        break;
+                case 0x7:
+                        STORE_BYTES(registers[v_x], y - x, mask);
+                        STORE_BYTES(registers[0xF], FLAG(y >= x), mask);
+                        break;
+                case 0xE:
+                        STORE_BYTES(registers[v_x], shifted << 1, mask);
+                        STORE_BYTES(registers[0xF], shifted >> 7, mask);
+                        break;
+                default:
+                        return false;
+                }
+                if ((quirks & QUIRK_VF_RESET) && last_nibble >= 0x1 &&
+                    last_nibble <= 0x3)
+                        STORE_BYTES(registers[0xF], (LaneBytes){0}, mask);
+                break;
+        }
+        case 0x9:
+                next += WIDEN(FLAG(x != y)) * 2;
+                break;
+        case 0xA:
+                STORE_WORDS(lockstep->index_register,
+                            (LaneWords){0} + address, word_mask);
+                break;
+        case 0xB:
+                next = WIDEN(quirks & QUIRK_JUMP_VX ? x
+                                                    : LOAD_BYTES(registers[0])) +
+                       address;
+                break;
+        case 0xF: {
+                const LaneWords index = LOAD_WORDS(lockstep->index_register);
+                switch (second_byte) {
+                case 0x07:
+                        STORE_BYTES(registers[v_x],
+                                    LOAD_BYTES(lockstep->delay_timer), mask);
+                        break;
+                case 0x15:
+                        STORE_BYTES(lockstep->delay_timer, x, mask);
+                        break;
+                case 0x18:
+                        STORE_BYTES(lockstep->sound_timer, x, mask);
+                        break;
+                case 0x1E:
+                        STORE_WORDS(lockstep->index_register,
+                                    index + WIDEN(x), word_mask);
+                        break;
+                case 0x29:
+                        STORE_WORDS(lockstep->index_register,
+                                    WIDEN(x) * 5 + FONTSET_START, word_mask);
+                        break;
+                default:
+                        return false;
+                }
+                break;
+        }
+        default:
+                return false;
+        }
+
+        STORE_WORDS(lockstep->program_counter, next, word_mask);
+        return true;
+}
+
+static void tick_lanes(Lockstep *lockstep) {
+        const LaneBytes delay_timer = LOAD_BYTES(lockstep->delay_timer);
+        const LaneBytes sound_timer = LOAD_BYTES(lockstep->sound_timer);
+        // Comparações valem -1 (0xFF): somar decrementa os timers não zerados
+        const LaneBytes delay = delay_timer + (LaneBytes)(delay_timer != 0);
+        const LaneBytes sound = sound_timer + (LaneBytes)(sound_timer != 0);
+        memcpy(lockstep->delay_timer, &delay, sizeof(delay));
+        memcpy(lockstep->sound_timer, &sound, sizeof(sound));
+}
+
+#else
+
+static bool execute_group(Lockstep *lockstep, uint8_t first_byte,
+                          uint8_t second_byte, uint32_t group,
+                          uint8_t quirks) {
+        (void)lockstep;
+        (void)first_byte;
+        (void)second_byte;
+        (void)group;
+        (void)quirks;
+        return false;
+}
+
+static void tick_lanes(Lockstep *lockstep) {
+        for (uint32_t lane = 0; lane < LOCKSTEP_LANES; ++lane) {
+                if (lockstep->delay_timer[lane] > 0)
+                        lockstep->delay_timer[lane]--;
+                if (lockstep->sound_timer[lane] > 0)
+                        lockstep->sound_timer[lane]--;
+        }
+}
+
+#endif
+
+void lockstep_init(Lockstep *lockstep, uint32_t lane_count, uint8_t *program,
+                   size_t program_size, uint32_t instructions_per_tick) {
+        memset(lockstep, 0, sizeof(*lockstep));
+        lockstep->lane_count =
+            lane_count > LOCKSTEP_LANES ? LOCKSTEP_LANES : lane_count;
+        lockstep->instructions_per_tick = instructions_per_tick;
+        lockstep->instructions_until_tick = instructions_per_tick;
+        for (uint32_t lane = 0; lane < lockstep->lane_count; ++lane) {
+                init(&lockstep->machines[lane], program, program_size);
+                store_lane(lockstep, lane);
+        }
+}
+
+void lockstep_read_lane(const Lockstep *lockstep, uint32_t lane,
+                        Chip8 *chip8) {
+        *chip8 = lockstep->machines[lane];
+        chip8->instructions_per_tick = lockstep->instructions_per_tick;
+        // A instância parada tem o estado completo do momento da falha
+        if (chip8->trap.fault != FAULT_NONE)
+                return;
+
+        for (uint8_t i = 0; i < REGISTER_COUNT; ++i) {
+                chip8->registers[i] = lockstep->registers[i][lane];
+        }
+        chip8->index_register = lockstep->index_register[lane];
+        chip8->program_counter = lockstep->program_counter[lane];
+        chip8->delay_timer = lockstep->delay_timer[lane];
+        chip8->sound_timer = lockstep->sound_timer[lane];
+        chip8->instructions_until_tick = lockstep->instructions_until_tick;
+        chip8->cycle_count = lockstep->cycle_count;
+}
+
+void lockstep_write_lane(Lockstep *lockstep, uint32_t lane,
+                         const Chip8 *chip8) {
+        lockstep->machines[lane] = *chip8;
+        // Os timers da instância são avançados pelo relógio compartilhado
+        lockstep->machines[lane].instructions_per_tick = 0;
+        lockstep->machines[lane].trace = NULL;
+        store_lane(lockstep, lane);
+}
+
+// Uma instrução em cada instância: agrupa as que estão no mesmo PC com a
+// mesma instrução na memória e o mesmo perfil de quirks, e executa cada grupo
+// de uma vez
+static void step_lanes(Lockstep *lockstep) {
+        const uint32_t lane_count = lockstep->lane_count;
+        // Instâncias que falharam ficam paradas na instrução da falha
+        uint32_t pending = 0;
+        for (uint32_t lane = 0; lane < lane_count; ++lane) {
+                if (lockstep->machines[lane].trap.fault == FAULT_NONE)
+                        pending |= UINT32_C(1) << lane;
+        }
+
+        uint32_t leader = 0;
+        while (pending != 0) {
+                while (((pending >> leader) & 1) == 0) {
+                        leader++;
+                }
+                const uint16_t pc = lockstep->program_counter[leader];
+                // A busca fora da memória falha, no caminho escalar
+                if (pc >= MEMORY_SIZE - 1) {
+                        pending &= ~(UINT32_C(1) << leader);
+                        execute_lane(lockstep, leader);
+                        continue;
+                }
+                const uint8_t first_byte =
+                    lockstep->machines[leader].memory[pc];
+                const uint8_t second_byte =
+                    lockstep->machines[leader].memory[pc + 1];
+                const uint8_t profile = lockstep->machines[leader].quirks;
+
+                uint32_t group = 0;
+                for (uint32_t lane = leader; lane < lane_count; ++lane) {
+                        const Chip8 *chip8 = &lockstep->machines[lane];
+                        if (((pending >> lane) & 1) &&
+                            lockstep->program_counter[lane] == pc &&
+                            chip8->memory[pc] == first_byte &&
+                            chip8->memory[pc + 1] == second_byte &&
+                            chip8->quirks == profile)
+                                group |= UINT32_C(1) << lane;
+                }
+                pending &= ~group;
+
+                if (!execute_group(lockstep, first_byte, second_byte, group,
+                                   quirk_flags(profile))) {
+                        for (uint32_t lane = leader; lane < lane_count;
+                             ++lane) {
+                                if ((group >> lane) & 1)
+                                        execute_lane(lockstep, lane);
+                        }
+                }
+        }
+}
+
+void lockstep_run(Lockstep *lockstep, uint32_t instructions) {
+        for (uint32_t i = 0; i < instructions; ++i) {
+                step_lanes(lockstep);
+
+                lockstep->cycle_count++;
+                if (lockstep->instructions_per_tick > 0 &&
+                    --lockstep->instructions_until_tick == 0) {
+                        lockstep->instructions_until_tick =
+                            lockstep->instructions_per_tick;
+                        tick_lanes(lockstep);
+                }
+        }
+}
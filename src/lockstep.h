@@ -0,0 +1,50 @@
+#include "system.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+// Máximo de instâncias executadas lado a lado
+#define LOCKSTEP_LANES 32
+
+// Várias instâncias da mesma ROM, com os registradores em estrutura de
+// arrays: `registers[N][lane]` é o VN de cada instância. Instâncias no mesmo
+// PC executando a mesma instrução avançam juntas, uma operação vetorial por
+// instrução; as demais passam pelo `execute()`, uma de cada vez.
+typedef struct {
+        uint32_t lane_count;
+        uint8_t registers[REGISTER_COUNT][LOCKSTEP_LANES];
+        uint16_t index_register[LOCKSTEP_LANES];
+        uint16_t program_counter[LOCKSTEP_LANES];
+        uint8_t delay_timer[LOCKSTEP_LANES];
+        uint8_t sound_timer[LOCKSTEP_LANES];
+
+        // Todas as instâncias executam o mesmo número de instruções, então
+        // compartilham o relógio dos timers
+        uint32_t instructions_per_tick;
+        uint32_t instructions_until_tick;
+        uint64_t cycle_count;
+
+        // Restante do estado de cada instância: memória, pilha, tela e
+        // teclado. Os registradores, I, PC e timers válidos são os de cima.
+        Chip8 machines[LOCKSTEP_LANES];
+
+        // Máscara vetorial do último grupo de instâncias executado
+        uint32_t mask_group;
+        int8_t mask[LOCKSTEP_LANES];
+} Lockstep;
+
+void lockstep_init(Lockstep *lockstep, uint32_t lane_count, uint8_t *program,
+                   size_t program_size, uint32_t instructions_per_tick);
+// Copia o estado completo de uma instância para `chip8`. Uma instância que
+// falhou (`chip8->trap`) fica parada, com o relógio do momento da falha.
+void lockstep_read_lane(const Lockstep *lockstep, uint32_t lane,
+                        Chip8 *chip8);
+// Substitui o estado de uma instância, exceto o relógio compartilhado
+void lockstep_write_lane(Lockstep *lockstep, uint32_t lane,
+                         const Chip8 *chip8);
+// Executa `instructions` instruções em cada instância
+void lockstep_run(Lockstep *lockstep, uint32_t instructions);
+
+#endif
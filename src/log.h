@@ -0,0 +1,46 @@
+#include <stdbool.h>
+#ifndef NO_LOGGING
+#include <SDL3/SDL_log.h>
+#endif
+
+#ifndef LOG_H
+#define LOG_H
+
+// Níveis de log, do mais detalhado ao mais grave
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_NONE 3
+
+// Nível mínimo compilado no binário. Chamadas abaixo dele viram código
+// vazio, sem custo nenhum no caminho de cada instrução. Builds DEBUG incluem
+// o trace; `./nob --trace` também.
+#ifndef LOG_MIN_LEVEL
+#if defined(NO_LOGGING)
+#define LOG_MIN_LEVEL LOG_LEVEL_NONE
+#elif defined(DEBUG)
+#define LOG_MIN_LEVEL LOG_LEVEL_TRACE
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+#endif
+
+// Liga o trace em tempo de execução (`-vv`). Só existe efeito quando o trace
+// foi compilado.
+extern bool log_trace_enabled;
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_TRACE
+// Um único teste de uma flag global antes de qualquer formatação
+#define LOG_TRACE(...)                                                         \
+        do {                                                                   \
+                if (log_trace_enabled)                                         \
+                        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,             \
+                                     __VA_ARGS__);                             \
+        } while (0)
+#else
+#define LOG_TRACE(...)                                                         \
+        do {                                                                   \
+        } while (0)
+#endif
+
+#endif
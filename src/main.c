@@ -1,9 +1,19 @@
+#include "decode_cache.h"
 #include "errors.h"
+#include "jit.h"
+#include "log.h"
+#include "movie.h"
+#include "rewind.h"
+#include "savestate.h"
 #include "system.h"
+#include "threaded.h"
+#include "trace.h"
 #include <SDL3/SDL_events.h>
 #include <SDL3/SDL_init.h>
 #include <SDL3/SDL_keycode.h>
+#include <SDL3/SDL_scancode.h>
 #include <SDL3/SDL_log.h>
+#include <SDL3/SDL_pixels.h>
 #include <SDL3/SDL_rect.h>
 #include <SDL3/SDL_render.h>
 #include <SDL3/SDL_timer.h>
@@ -11,22 +21,82 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
-
-#define SCREEN_SCALE 20
-// Intervalo para os timers de 60Hz
-const uint64_t TIMER_INTERVAL = 1000000 / 60;
-// Intervalo simulando o clock do Chip8
-const uint64_t UPDATE_INTERVAL = 1000000 / 500;
+#include <string.h>
+
+// Pixels da janela por pixel de alta resolução
+#define SCREEN_SCALE 10
+// Cores dos pixels no formato ARGB8888
+#define PIXEL_ON_COLOR 0xFFFFFFFF
+#define PIXEL_OFF_COLOR 0xFF333333
+// Quadros por segundo (timers e tela)
+#define FRAME_RATE 60
+// Duração de um quadro, em nanossegundos
+const uint64_t FRAME_INTERVAL = 1000000000 / FRAME_RATE;
+// Instruções executadas a cada quadro, simulando um clock de 500Hz
+const uint64_t INSTRUCTIONS_PER_FRAME = 500 / FRAME_RATE;
+// No modo turbo, instruções executadas entre consultas ao relógio
+const uint64_t TURBO_BATCH = 1024;
+// Histórico padrão para voltar no tempo
+const uint32_t REWIND_SECONDS = 60;
+const uint64_t REWIND_MEMORY_MB = 16;
+// Teclado hexadecimal do COSMAC VIP nas mesmas posições do teclado do host
+// (1234/QWER/ASDF/ZXCV). Por scancode, para não depender do layout; 0 para
+// teclas sem correspondente.
+const uint16_t KEY_MASKS[SDL_SCANCODE_COUNT] = {
+    [SDL_SCANCODE_1] = 1 << 0x1, [SDL_SCANCODE_2] = 1 << 0x2,
+    [SDL_SCANCODE_3] = 1 << 0x3, [SDL_SCANCODE_4] = 1 << 0xC,
+    [SDL_SCANCODE_Q] = 1 << 0x4, [SDL_SCANCODE_W] = 1 << 0x5,
+    [SDL_SCANCODE_E] = 1 << 0x6, [SDL_SCANCODE_R] = 1 << 0xD,
+    [SDL_SCANCODE_A] = 1 << 0x7, [SDL_SCANCODE_S] = 1 << 0x8,
+    [SDL_SCANCODE_D] = 1 << 0x9, [SDL_SCANCODE_F] = 1 << 0xE,
+    [SDL_SCANCODE_Z] = 1 << 0xA, [SDL_SCANCODE_X] = 1 << 0x0,
+    [SDL_SCANCODE_C] = 1 << 0xB, [SDL_SCANCODE_V] = 1 << 0xF,
+};
+
+// Núcleos de execução disponíveis
+typedef enum {
+        // `run()`: decodifica cada instrução a cada execução
+        ENGINE_SWITCH,
+        // `step_cached()`: reaproveita instruções pré-decodificadas
+        ENGINE_CACHED,
+        // `run_threaded()`: despacho por computed goto, várias instruções
+        // por chamada
+        ENGINE_THREADED,
+        // `run_jit()`: traduz blocos básicos para código x86-64
+        ENGINE_JIT,
+} Engine;
 
 typedef struct {
         SDL_Window *window;
         SDL_Renderer *renderer;
-        SDL_FRect display_pixels[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+        // Textura DISPLAY_WIDTH x DISPLAY_HEIGHT (128x64) atualizada a cada
+        // quadro; só a área da resolução atual é amostrada e escalada pela GPU
+        SDL_Texture *display_texture;
         Chip8 *chip8;
-        // Marca se o interpretador deve avançar o programa
-        uint64_t timestamp_update;
-        uint64_t timestamp_delay;
-        uint64_t timestamp_sound;
+        Engine engine;
+        DecodeCache *decode_cache;
+        JitCache *jit_cache;
+        TraceBuffer *trace;
+        // Arquivo usado pelas teclas F5 (salvar) e F9 (carregar)
+        char *state_path;
+        // Histórico de quadros (NULL = desativado); volta enquanto a tecla
+        // Backspace estiver pressionada
+        Rewind *rewind;
+        bool rewinding;
+        // Filme sendo gravado ou reproduzido (NULL = nenhum). Enquanto houver
+        // um, voltar no tempo e carregar estados ficam desativados.
+        Movie *movie;
+        bool movie_recording;
+        char *movie_path;
+        // A reprodução divergiu da gravação
+        bool movie_desync;
+        uint64_t instructions_per_frame;
+        // Executa sem limite de velocidade, mantendo a tela e os timers a
+        // 60Hz
+        bool turbo;
+        // Timers avançam pelo relógio de parede, não pelas instruções
+        bool realtime_timers;
+        // Em builds DEBUG, marca se o interpretador deve avançar o programa
         bool update;
         bool quit;
 } AppContext;
@@ -34,19 +104,59 @@ typedef struct {
 typedef struct {
         char *filename;
         SDL_LogPriority log_priority;
+        // Executa sem janela, o mais rápido possível
+        bool headless;
+        // Limites de execução no modo headless (0 = sem limite)
+        uint64_t max_cycles;
+        uint64_t max_frames;
+        Engine engine;
+        // Velocidade da CPU (0 = padrão)
+        uint64_t instructions_per_frame;
+        bool turbo;
+        bool realtime_timers;
+        // Arquivo de trace binário (NULL = sem trace) e sua capacidade
+        char *trace_file;
+        uint32_t trace_records;
+        // Estado carregado ao iniciar e estado salvo ao final do modo
+        // headless
+        char *load_state;
+        char *save_state;
+        // Semente do gerador do CxNN
+        uint64_t seed;
+        // Perfil de compatibilidade da ROM
+        QuirkProfile quirks;
+        // Arquivos de filme (entrada gravada)
+        char *record_movie;
+        char *play_movie;
+        // Memória do histórico de quadros, em MiB (0 = desativado)
+        uint64_t rewind_memory_mb;
+        uint32_t rewind_seconds;
 } CliArguments;
 
 // Initialização
 void init_app(AppContext *app_context, CliArguments *cli_arguments);
 CliArguments parse_arguments(int argc, char *argv[]);
 void load_instructions(Chip8 *chip8, char *filename);
+// Modo headless
+void run_headless(AppContext *app_context, CliArguments *cli_arguments);
+void print_state(Chip8 *chip8);
 // Funções principais do interpretador
+uint64_t execute_instructions(AppContext *app_context, uint64_t count);
+uint64_t execute_with_movie(AppContext *app_context, uint64_t count);
+bool movie_playing(const AppContext *app_context);
+void stop_movie(AppContext *app_context);
 void run_interpreter_loop(AppContext *app_context);
+void run_frame(AppContext *app_context, uint64_t deadline);
 void handle_events(AppContext *app_context);
 void render(AppContext *app_context);
-void try_match_key(Chip8 *chip8, SDL_Keycode key);
+void update_key(Chip8 *chip8, SDL_Scancode scancode, bool down);
+void save_state(AppContext *app_context);
+void load_state(AppContext *app_context);
 // Funções associadas aos timers
-void update_timers(AppContext *app_context);
+bool frame_clock_timers(const AppContext *app_context);
+void apply_timing(AppContext *app_context);
+void wait_until(uint64_t deadline);
+bool wait_for_key_event(AppContext *app_context, uint64_t deadline);
 
 int main(int argc, char *argv[]) {
         CliArguments cli_arguments = parse_arguments(argc, argv);
@@ -54,18 +164,117 @@ int main(int argc, char *argv[]) {
 
         init_app(&app_context, &cli_arguments);
 
-        run_interpreter_loop(&app_context);
+        if (cli_arguments.headless) {
+                run_headless(&app_context, &cli_arguments);
+        } else {
+                run_interpreter_loop(&app_context);
+        }
+
+        if (app_context.trace != NULL)
+                trace_close(app_context.trace);
+        if (app_context.movie != NULL)
+                stop_movie(&app_context);
 
         SDL_Quit();
-        return 0;
+        return app_context.chip8->trap.fault == FAULT_NONE &&
+                       !app_context.movie_desync
+                   ? EXIT_SUCCESS
+                   : EXIT_FAILURE;
 }
 
 CliArguments parse_arguments(int argc, char *argv[]) {
-        CliArguments cli_arguments;
+        CliArguments cli_arguments = {0};
         cli_arguments.log_priority = SDL_LOG_PRIORITY_INFO;
-
-        for (int i = 0; i < argc; i++) {
-                if (strncmp(argv[i], "-vv", 3) == 0) {
+        cli_arguments.rewind_memory_mb = REWIND_MEMORY_MB;
+        cli_arguments.rewind_seconds = REWIND_SECONDS;
+
+        for (int i = 1; i < argc; i++) {
+                if (strcmp(argv[i], "--headless") == 0) {
+                        cli_arguments.headless = true;
+                } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+                        cli_arguments.max_cycles = strtoull(argv[++i], NULL, 0);
+                } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+                        cli_arguments.max_frames = strtoull(argv[++i], NULL, 0);
+                } else if (strcmp(argv[i], "--ips") == 0 && i + 1 < argc) {
+                        const uint64_t ips = strtoull(argv[++i], NULL, 0);
+                        cli_arguments.instructions_per_frame =
+                            (ips + FRAME_RATE / 2) / FRAME_RATE;
+                        if (cli_arguments.instructions_per_frame == 0)
+                                cli_arguments.instructions_per_frame = 1;
+                } else if (strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) {
+                        cli_arguments.instructions_per_frame =
+                            strtoull(argv[++i], NULL, 0);
+                } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+                        cli_arguments.seed = strtoull(argv[++i], NULL, 0);
+                } else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+                        const char *quirks = argv[++i];
+                        if (!parse_quirk_profile(quirks,
+                                                 &cli_arguments.quirks)) {
+                                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                                             "Perfil de quirks desconhecido: "
+                                             "%s\n",
+                                             quirks);
+                                exit(EXIT_FAILURE);
+                        }
+                } else if (strcmp(argv[i], "--turbo") == 0) {
+                        cli_arguments.turbo = true;
+                } else if (strcmp(argv[i], "--timing") == 0 && i + 1 < argc) {
+                        const char *timing = argv[++i];
+                        if (strcmp(timing, "cycles") == 0) {
+                                cli_arguments.realtime_timers = false;
+                        } else if (strcmp(timing, "realtime") == 0) {
+                                cli_arguments.realtime_timers = true;
+                        } else {
+                                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                                             "Modo de timing desconhecido: "
+                                             "%s\n",
+                                             timing);
+                                exit(EXIT_FAILURE);
+                        }
+                } else if (strcmp(argv[i], "--trace-file") == 0 &&
+                           i + 1 < argc) {
+                        cli_arguments.trace_file = argv[++i];
+                } else if (strcmp(argv[i], "--trace-records") == 0 &&
+                           i + 1 < argc) {
+                        cli_arguments.trace_records =
+                            (uint32_t)strtoul(argv[++i], NULL, 0);
+                } else if (strcmp(argv[i], "--load-state") == 0 &&
+                           i + 1 < argc) {
+                        cli_arguments.load_state = argv[++i];
+                } else if (strcmp(argv[i], "--save-state") == 0 &&
+                           i + 1 < argc) {
+                        cli_arguments.save_state = argv[++i];
+                } else if (strcmp(argv[i], "--record-movie") == 0 &&
+                           i + 1 < argc) {
+                        cli_arguments.record_movie = argv[++i];
+                } else if (strcmp(argv[i], "--play-movie") == 0 &&
+                           i + 1 < argc) {
+                        cli_arguments.play_movie = argv[++i];
+                } else if (strcmp(argv[i], "--rewind-memory") == 0 &&
+                           i + 1 < argc) {
+                        cli_arguments.rewind_memory_mb =
+                            strtoull(argv[++i], NULL, 0);
+                } else if (strcmp(argv[i], "--rewind-seconds") == 0 &&
+                           i + 1 < argc) {
+                        cli_arguments.rewind_seconds =
+                            (uint32_t)strtoul(argv[++i], NULL, 0);
+                } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+                        const char *engine = argv[++i];
+                        if (strcmp(engine, "switch") == 0) {
+                                cli_arguments.engine = ENGINE_SWITCH;
+                        } else if (strcmp(engine, "cached") == 0) {
+                                cli_arguments.engine = ENGINE_CACHED;
+                        } else if (strcmp(engine, "threaded") == 0) {
+                                cli_arguments.engine = ENGINE_THREADED;
+                        } else if (strcmp(engine, "jit") == 0) {
+                                cli_arguments.engine = ENGINE_JIT;
+                        } else {
+                                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                                             "Engine desconhecida: %s\n",
+                                             engine);
+                                exit(EXIT_FAILURE);
+                        }
+                } else if (strncmp(argv[i], "-vv", 3) == 0) {
                         cli_arguments.log_priority = SDL_LOG_PRIORITY_TRACE;
                 } else if (strncmp(argv[i], "-v", 2) == 0) {
                         cli_arguments.log_priority = SDL_LOG_PRIORITY_VERBOSE;
@@ -73,63 +282,488 @@ CliArguments parse_arguments(int argc, char *argv[]) {
                         cli_arguments.filename = argv[i];
                 }
         }
+
+        if (cli_arguments.filename == NULL) {
+                log_error(NO_FILE_PROVIDED);
+                exit(EXIT_FAILURE);
+        }
         return cli_arguments;
 }
 
 void init_app(AppContext *app_context, CliArguments *cli_arguments) {
-        app_context->chip8 = malloc(sizeof(Chip8));
+        app_context->chip8 = aligned_alloc(_Alignof(Chip8), sizeof(Chip8));
+        memset(app_context->chip8, 0, sizeof(Chip8));
+        app_context->engine = cli_arguments->engine;
+        app_context->decode_cache = NULL;
+        app_context->jit_cache = NULL;
+        app_context->trace = NULL;
+        app_context->rewind = NULL;
+        app_context->rewinding = false;
+        app_context->movie = NULL;
+        app_context->movie_recording = false;
+        app_context->movie_path = NULL;
+        app_context->movie_desync = false;
+        app_context->state_path = cli_arguments->save_state;
+        if (app_context->state_path == NULL)
+                app_context->state_path = cli_arguments->load_state;
+        if (app_context->state_path == NULL) {
+                const size_t length = strlen(cli_arguments->filename);
+                app_context->state_path = malloc(length + sizeof(".state"));
+                memcpy(app_context->state_path, cli_arguments->filename,
+                       length);
+                memcpy(app_context->state_path + length, ".state",
+                       sizeof(".state"));
+        }
+        app_context->instructions_per_frame =
+            cli_arguments->instructions_per_frame > 0
+                ? cli_arguments->instructions_per_frame
+                : INSTRUCTIONS_PER_FRAME;
+        app_context->turbo = cli_arguments->turbo;
+        app_context->realtime_timers = cli_arguments->realtime_timers;
         app_context->quit = false;
-        app_context->update = true;
+        app_context->update = false;
+
+        SDL_SetLogPriority(SDL_LOG_CATEGORY_APPLICATION,
+                           cli_arguments->log_priority);
+        log_trace_enabled =
+            cli_arguments->log_priority == SDL_LOG_PRIORITY_TRACE;
+#if LOG_MIN_LEVEL > LOG_LEVEL_TRACE
+        if (log_trace_enabled) {
+                SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                            "Trace não incluído neste build, use "
+                            "`./nob --trace`\n");
+        }
+#endif
+
+        // O filme traz a semente, os quirks e o ritmo dos timers da gravação
+        if (cli_arguments->play_movie != NULL) {
+                app_context->movie = malloc(sizeof(Movie));
+                if (!movie_load(app_context->movie,
+                                cli_arguments->play_movie) ||
+                    app_context->movie->instructions_per_tick == 0) {
+                        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                                     "Filme inválido: %s\n",
+                                     cli_arguments->play_movie);
+                        exit(EXIT_FAILURE);
+                }
+                app_context->movie_path = cli_arguments->play_movie;
+                cli_arguments->seed = app_context->movie->seed;
+                cli_arguments->quirks = app_context->movie->quirks;
+                app_context->instructions_per_frame =
+                    app_context->movie->instructions_per_tick;
+                app_context->realtime_timers = false;
+        }
+
+        // A semente e o perfil vêm antes do programa, que reinicia o gerador
+        set_random_seed(app_context->chip8, cli_arguments->seed);
+        set_quirk_profile(app_context->chip8, cli_arguments->quirks);
+        load_instructions(app_context->chip8, cli_arguments->filename);
+        // Por padrão os timers avançam a cada `instructions_per_frame`
+        // instruções, de forma que a mesma ROM sempre produza o mesmo
+        // resultado, independente do relógio e do núcleo de execução
+        if (!app_context->realtime_timers) {
+                set_instructions_per_tick(app_context->chip8,
+                                          app_context->instructions_per_frame);
+        }
+
+        // Só o `step()` grava o trace, então os outros núcleos são trocados
+        // pelo switch
+        if (cli_arguments->trace_file != NULL) {
+                app_context->trace = malloc(sizeof(TraceBuffer));
+                const uint32_t capacity = cli_arguments->trace_records > 0
+                                              ? cli_arguments->trace_records
+                                              : TRACE_DEFAULT_CAPACITY;
+                if (!trace_open(app_context->trace, capacity,
+                                cli_arguments->trace_file)) {
+                        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                                     "Não foi possível criar o trace: %s\n",
+                                     cli_arguments->trace_file);
+                        exit(EXIT_FAILURE);
+                }
+                app_context->chip8->trace = app_context->trace;
+                if (app_context->engine != ENGINE_SWITCH) {
+                        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                                    "Trace ativo, usando a engine switch\n");
+                        app_context->engine = ENGINE_SWITCH;
+                }
+        }
+
+        if (app_context->engine == ENGINE_CACHED) {
+                app_context->decode_cache = malloc(sizeof(DecodeCache));
+                decode_cache_attach(app_context->decode_cache,
+                                    app_context->chip8);
+        }
+        if (app_context->engine == ENGINE_JIT) {
+                app_context->jit_cache = malloc(sizeof(JitCache));
+                if (!jit_attach(app_context->jit_cache, app_context->chip8)) {
+                        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                                    "JIT indisponível, usando o "
+                                    "interpretador\n");
+                }
+        }
+
+        // Carregado depois dos caches, que são invalidados pelo hook de
+        // escrita na memória
+        if (cli_arguments->load_state != NULL &&
+            !savestate_load(app_context->chip8, cli_arguments->load_state)) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                             "Estado inválido: %s\n",
+                             cli_arguments->load_state);
+                exit(EXIT_FAILURE);
+        }
+
+        // A gravação começa do estado inicial, já com o estado carregado.
+        // Com os timers no relógio de parede a execução não se repete.
+        if (cli_arguments->record_movie != NULL &&
+            app_context->movie == NULL) {
+                if (app_context->realtime_timers) {
+                        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                                     "Filmes precisam de --timing cycles\n");
+                        exit(EXIT_FAILURE);
+                }
+                app_context->movie = malloc(sizeof(Movie));
+                // Um estado salvo em turbo traz os timers no quadro
+                apply_timing(app_context);
+                movie_start(app_context->movie, app_context->chip8,
+                            app_context->instructions_per_frame * FRAME_RATE);
+                app_context->movie_recording = true;
+                app_context->movie_path = cli_arguments->record_movie;
+        }
+
+        // No modo headless não há janela nem renderer
+        if (cli_arguments->headless)
+                return;
+
+        if (app_context->movie == NULL &&
+            cli_arguments->rewind_memory_mb > 0 &&
+            cli_arguments->rewind_seconds > 0) {
+                app_context->rewind = malloc(sizeof(Rewind));
+                if (!rewind_init(app_context->rewind,
+                                 cli_arguments->rewind_memory_mb << 20,
+                                 cli_arguments->rewind_seconds * FRAME_RATE,
+                                 REWIND_KEYFRAME_INTERVAL)) {
+                        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                                    "Sem memória para o histórico de "
+                                    "quadros\n");
+                        free(app_context->rewind);
+                        app_context->rewind = NULL;
+                }
+        }
 
         SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS);
         SDL_CreateWindowAndRenderer("CHIP-8", DISPLAY_WIDTH * SCREEN_SCALE,
                                     DISPLAY_HEIGHT * SCREEN_SCALE, 0,
                                     &app_context->window,
                                     &app_context->renderer);
-        SDL_SetLogPriority(SDL_LOG_CATEGORY_APPLICATION,
-                           cli_arguments->log_priority);
-
-        load_instructions(app_context->chip8, cli_arguments->filename);
+        app_context->display_texture = SDL_CreateTexture(
+            app_context->renderer, SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        SDL_SetTextureScaleMode(app_context->display_texture,
+                                SDL_SCALEMODE_NEAREST);
 
         SDL_ShowWindow(app_context->window);
 }
 
+// Executa até `count` instruções e retorna quantas foram executadas. Uma
+// falha para a execução, que só volta com F9 ou voltando no tempo.
+uint64_t execute_instructions(AppContext *app_context, uint64_t count) {
+        Chip8 *chip8 = app_context->chip8;
+        if (chip8->trap.fault != FAULT_NONE)
+                return 0;
+
+        uint64_t executed = 0;
+        switch (app_context->engine) {
+        case ENGINE_SWITCH:
+                // `run()` só volta antes do fim em eventos; a tela é
+                // apresentada uma vez por quadro de qualquer forma
+                while (executed < count) {
+                        const uint64_t before = chip8->cycle_count;
+                        const uint64_t remaining = count - executed;
+                        const RunReason reason =
+                            run(chip8, remaining > UINT32_MAX ? UINT32_MAX
+                                                              : remaining);
+                        executed += chip8->cycle_count - before;
+                        if (reason == RUN_FAULT)
+                                break;
+                        // Bloqueado num Fx0A, o resto do lote só avança o
+                        // relógio
+                        if (reason == RUN_WAITING_KEY) {
+                                const uint64_t rest = count - executed;
+                                executed += run_idle_loop(
+                                    chip8,
+                                    rest > UINT32_MAX ? UINT32_MAX : rest);
+                        }
+                }
+                break;
+        case ENGINE_CACHED:
+                while (executed < count &&
+                       step_cached(chip8, app_context->decode_cache) ==
+                           FAULT_NONE) {
+                        executed++;
+                }
+                break;
+        case ENGINE_THREADED:
+                executed = run_threaded(chip8, count);
+                break;
+        case ENGINE_JIT:
+                executed = run_jit(chip8, app_context->jit_cache, count);
+                break;
+        }
+
+        if (chip8->trap.fault != FAULT_NONE)
+                log_trap(&chip8->trap);
+        return executed;
+}
+
+// Executa até `count` instruções gravando ou reproduzindo o filme, se houver
+uint64_t execute_with_movie(AppContext *app_context, uint64_t count) {
+        Movie *movie = app_context->movie;
+        if (movie == NULL)
+                return execute_instructions(app_context, count);
+        if (app_context->movie_recording) {
+                movie_record(movie, app_context->chip8);
+                return execute_instructions(app_context, count);
+        }
+
+        // Na reprodução, os lotes param em cada evento gravado
+        uint64_t executed = 0;
+        while (executed < count) {
+                const uint64_t remaining = count - executed;
+                uint32_t budget =
+                    remaining > UINT32_MAX ? UINT32_MAX : remaining;
+                const MovieStatus status =
+                    movie_play(movie, app_context->chip8, &budget);
+                if (status == MOVIE_DESYNC) {
+                        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                                     "Filme dessincronizado no ciclo %llu\n",
+                                     (unsigned long long)
+                                         app_context->chip8->cycle_count);
+                        app_context->movie_desync = true;
+                }
+                if (status != MOVIE_PLAYING) {
+                        stop_movie(app_context);
+                        break;
+                }
+                const uint64_t ran = execute_instructions(app_context, budget);
+                executed += ran;
+                if (ran < budget)
+                        break;
+        }
+        return executed;
+}
+
+bool movie_playing(const AppContext *app_context) {
+        return app_context->movie != NULL && !app_context->movie_recording;
+}
+
+// Termina o filme: a gravação é salva, a reprodução devolve o controle ao
+// teclado
+void stop_movie(AppContext *app_context) {
+        Movie *movie = app_context->movie;
+        if (app_context->movie_recording) {
+                movie_finish(movie, app_context->chip8);
+                if (!movie_save(movie, app_context->movie_path)) {
+                        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                                     "Não foi possível salvar o filme: %s\n",
+                                     app_context->movie_path);
+                }
+        } else if (!app_context->movie_desync) {
+                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Fim do filme: %s\n",
+                            app_context->movie_path);
+        }
+        movie_free(movie);
+        free(movie);
+        app_context->movie = NULL;
+}
+
+// Laço principal, em quadros de 60Hz: lê a entrada uma vez, executa um lote
+// de instruções, avança os timers (no modo realtime), apresenta a tela e
+// dorme até o próximo quadro
 void run_interpreter_loop(AppContext *app_context) {
+        uint64_t next_frame = SDL_GetTicksNS();
+
         while (!app_context->quit) {
-                handle_events(app_context);
+                next_frame += FRAME_INTERVAL;
 
-                update_timers(app_context);
-                if (app_context->update) {
-                        step(app_context->chip8);
-                        app_context->update = false;
+                handle_events(app_context);
+                apply_timing(app_context);
+                if (app_context->rewinding && app_context->rewind != NULL) {
+                        // Um quadro para trás a cada quadro
+                        rewind_pop(app_context->rewind, app_context->chip8);
+                } else {
+                        run_frame(app_context, next_frame);
+                        if (frame_clock_timers(app_context))
+                                tick_timers(app_context->chip8);
+                        if (app_context->rewind != NULL)
+                                rewind_push(app_context->rewind,
+                                            app_context->chip8);
                 }
 
                 if (app_context->chip8->redraw) {
                         render(app_context);
                 }
+
+                const uint64_t now = SDL_GetTicksNS();
+                // Se ficou mais de um quadro para trás, não tenta compensar
+                if (now > next_frame + FRAME_INTERVAL)
+                        next_frame = now;
+                // Uma tecla que libera o Fx0A começa o próximo quadro na hora
+                if (waiting_for_key(app_context->chip8) &&
+                    wait_for_key_event(app_context, next_frame)) {
+                        next_frame = SDL_GetTicksNS();
+                        continue;
+                }
+                wait_until(next_frame);
         }
 }
 
-void update_timers(AppContext *app_context) {
-        const uint64_t now = SDL_GetTicksNS();
+void run_frame(AppContext *app_context, uint64_t deadline) {
+#ifdef DEBUG
+        // Uma instrução por vez, avançando com a barra de espaço
+        (void)deadline;
+        if (app_context->update) {
+                execute_with_movie(app_context, 1);
+                app_context->update = false;
+        }
+#else
+        if (!app_context->turbo) {
+                execute_with_movie(app_context,
+                                   app_context->instructions_per_frame);
+                return;
+        }
 
-        if (now - app_context->timestamp_update > UPDATE_INTERVAL) {
-                app_context->timestamp_update = now;
-#ifndef DEBUG
-                app_context->update = true;
+        // Turbo: executa o quanto der até o fim do quadro. Com os timers no
+        // relógio do quadro, um laço de espera só sai no próximo quadro,
+        // então o resto do quadro é dormido. Uma instância que falhou não
+        // executa mais nada, e também dorme em vez de girar até o prazo.
+        do {
+                if (execute_with_movie(app_context, TURBO_BATCH) == 0 ||
+                    app_context->chip8->trap.fault != FAULT_NONE)
+                        break;
+                if (frame_clock_timers(app_context) &&
+                    idle_loop_length(app_context->chip8) > 0)
+                        break;
+        } while (SDL_GetTicksNS() < deadline);
 #endif
+}
+
+void run_headless(AppContext *app_context, CliArguments *cli_arguments) {
+        Chip8 *chip8 = app_context->chip8;
+        uint64_t cycles = 0;
+        uint64_t frames = 0;
+        bool halted = false;
+        const bool playing = movie_playing(app_context);
+        // Sem janela já não há limite de velocidade: o turbo não muda nada,
+        // e os timers seguem as instruções
+        app_context->turbo = false;
+        apply_timing(app_context);
+
+        const uint64_t start = SDL_GetTicksNS();
+        while (!halted) {
+                uint64_t batch = app_context->instructions_per_frame;
+                if (cli_arguments->max_cycles > 0 &&
+                    cli_arguments->max_cycles - cycles < batch) {
+                        batch = cli_arguments->max_cycles - cycles;
+                }
+                cycles += execute_with_movie(app_context, batch);
+                if (app_context->realtime_timers)
+                        tick_timers(chip8);
+
+                frames++;
+                if (cli_arguments->max_cycles > 0 &&
+                    cycles >= cli_arguments->max_cycles) {
+                        halted = true;
+                }
+                if (cli_arguments->max_frames > 0 &&
+                    frames >= cli_arguments->max_frames) {
+                        halted = true;
+                }
+                if (chip8->trap.fault != FAULT_NONE)
+                        halted = true;
+                // Um filme vai até o fim; sem ele e sem limite definido,
+                // para quando o programa trava
+                if (playing) {
+                        if (app_context->movie == NULL)
+                                halted = true;
+                } else if (cli_arguments->max_cycles == 0 &&
+                           cli_arguments->max_frames == 0 &&
+                           program_stuck(chip8)) {
+                        halted = true;
+                }
         }
+        const uint64_t elapsed = SDL_GetTicksNS() - start;
+
+        const double seconds = (double)elapsed / 1e9;
+        printf("cycles: %llu\n", (unsigned long long)cycles);
+        printf("frames: %llu\n", (unsigned long long)frames);
+        printf("elapsed: %.6f s\n", seconds);
+        printf("instructions/sec: %.0f\n",
+               seconds > 0 ? (double)cycles / seconds : 0.0);
+        print_state(chip8);
+        if (app_context->movie_desync)
+                printf("movie: desync\n");
+
+        if (cli_arguments->save_state != NULL)
+                save_state(app_context);
+}
 
-        if (app_context->chip8->delay_timer > 0 &&
-            now - app_context->timestamp_delay > TIMER_INTERVAL) {
-                app_context->timestamp_delay = now;
-                app_context->chip8->delay_timer--;
+void print_state(Chip8 *chip8) {
+        printf("PC: 0x%04X\n", chip8->program_counter);
+        printf("I: 0x%04X\n", chip8->index_register);
+        printf("SP: 0x%02X\n", chip8->stack_pointer);
+        printf("DT: 0x%02X\n", chip8->delay_timer);
+        printf("ST: 0x%02X\n", chip8->sound_timer);
+        for (uint8_t i = 0; i < REGISTER_COUNT; ++i) {
+                printf("V%X: 0x%02X%s", i, chip8->registers[i],
+                       (i % 4 == 3) ? "\n" : " | ");
         }
+        printf("display hash: 0x%016llX\n",
+               (unsigned long long)display_hash(chip8));
+        if (chip8->trap.fault != FAULT_NONE)
+                printf("fault: %s\n", fault_name(chip8->trap.fault));
+}
+
+// Com os timers nas instruções, o turbo os faria correr junto com elas.
+// Enquanto ele está ligado, avançam uma vez por quadro, como no modo
+// realtime. Filmes mantêm os timers nas instruções, para reproduzir igual.
+bool frame_clock_timers(const AppContext *app_context) {
+        return app_context->realtime_timers ||
+               (app_context->turbo && app_context->movie == NULL);
+}
+
+// Ajusta o `instructions_per_tick` ao modelo de tempo do quadro. Também
+// corrige o valor trazido por um estado carregado ou pelo rewind.
+void apply_timing(AppContext *app_context) {
+        const uint32_t instructions_per_tick =
+            frame_clock_timers(app_context)
+                ? 0
+                : (uint32_t)app_context->instructions_per_frame;
+        if (app_context->chip8->instructions_per_tick != instructions_per_tick)
+                set_instructions_per_tick(app_context->chip8,
+                                          instructions_per_tick);
+}
+
+void wait_until(uint64_t deadline) {
+        const uint64_t now = SDL_GetTicksNS();
+        if (deadline > now)
+                SDL_DelayPrecise(deadline - now);
+}
 
-        if (app_context->chip8->sound_timer > 0 &&
-            now - app_context->timestamp_sound > TIMER_INTERVAL) {
-                app_context->timestamp_sound = now;
-                app_context->chip8->sound_timer--;
+// Dorme na fila de eventos até o teclado do CHIP-8 mudar ou faltar menos de
+// 1ms para `deadline`. Retorna verdadeiro se o teclado mudou.
+bool wait_for_key_event(AppContext *app_context, uint64_t deadline) {
+        const uint16_t keypad = app_context->chip8->keypad;
+        for (;;) {
+                const uint64_t now = SDL_GetTicksNS();
+                if (now >= deadline || app_context->quit)
+                        return false;
+                const Sint32 timeout = (Sint32)((deadline - now) / 1000000);
+                if (timeout == 0)
+                        return false;
+                if (SDL_WaitEventTimeout(NULL, timeout))
+                        handle_events(app_context);
+                if (app_context->chip8->keypad != keypad)
+                        return true;
         }
 }
 
@@ -141,58 +775,123 @@ void handle_events(AppContext *app_context) {
                         app_context->quit = true;
                         break;
                 case SDL_EVENT_KEY_DOWN:
-                        try_match_key(app_context->chip8, event.key.key);
+                        if (!movie_playing(app_context))
+                                update_key(app_context->chip8,
+                                           event.key.scancode, true);
 
                         if (event.key.key == SDLK_ESCAPE) {
                                 app_context->quit = true;
                         }
+                        if (event.key.key == SDLK_TAB && !event.key.repeat) {
+                                app_context->turbo = !app_context->turbo;
+                                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                                            "Turbo %s\n",
+                                            app_context->turbo ? "ligado"
+                                                               : "desligado");
+                        }
+                        if (event.key.key == SDLK_BACKSPACE) {
+                                app_context->rewinding = true;
+                        }
+                        if (event.key.key == SDLK_F5 && !event.key.repeat) {
+                                save_state(app_context);
+                        }
+                        if (event.key.key == SDLK_F9 && !event.key.repeat) {
+                                load_state(app_context);
+                        }
 #ifdef DEBUG
                         if (event.key.key == SDLK_SPACE) {
                                 app_context->update = true;
                         }
 #endif
                         break;
+                case SDL_EVENT_KEY_UP:
+                        if (!movie_playing(app_context))
+                                update_key(app_context->chip8,
+                                           event.key.scancode, false);
+                        if (event.key.key == SDLK_BACKSPACE) {
+                                app_context->rewinding = false;
+                        }
+                        break;
+                case SDL_EVENT_WINDOW_FOCUS_LOST:
+                        // As teclas soltas fora da janela não geram eventos
+                        if (!movie_playing(app_context))
+                                app_context->chip8->keypad = 0;
+                        break;
                 default:
                         break;
                 }
         }
 }
 
-void try_match_key(Chip8 *chip8, SDL_Keycode key) {
-        SDL_Keycode emulated_keys[16] = {SDLK_X, SDLK_1, SDLK_2, SDLK_3, //
-                                         SDLK_Q, SDLK_W, SDLK_E, SDLK_A, //
-                                         SDLK_S, SDLK_D, SDLK_Z, SDLK_C, //
-                                         SDLK_4, SDLK_R, SDLK_F, SDLK_V};
+void update_key(Chip8 *chip8, SDL_Scancode scancode, bool down) {
+        if ((uint32_t)scancode >= SDL_SCANCODE_COUNT)
+                return;
+        if (down)
+                chip8->keypad |= KEY_MASKS[scancode];
+        else
+                chip8->keypad &= ~KEY_MASKS[scancode];
+}
 
-        for (uint8_t i = 0; i < 16; ++i) {
-                chip8->keypad[i] = (key == emulated_keys[i]);
+void save_state(AppContext *app_context) {
+        if (savestate_save(app_context->chip8, app_context->state_path)) {
+                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Estado salvo: %s\n",
+                            app_context->state_path);
+        } else {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                             "Não foi possível salvar o estado: %s\n",
+                             app_context->state_path);
         }
 }
 
-void render(AppContext *app_context) {
-        uint16_t n_pixels = 0;
-
-        for (uint16_t x = 0; x < DISPLAY_WIDTH; ++x) {
-                for (uint16_t y = 0; y < DISPLAY_HEIGHT; ++y) {
-                        const uint16_t index = (y * DISPLAY_WIDTH) + x;
-                        const SDL_FRect rect = {x * SCREEN_SCALE,
-                                                y * SCREEN_SCALE, SCREEN_SCALE,
-                                                SCREEN_SCALE};
-                        if (app_context->chip8->display[index] > 0) {
-                                app_context->display_pixels[n_pixels++] = rect;
-                        }
-                }
+void load_state(AppContext *app_context) {
+        // Um estado carregado quebraria a sequência do filme
+        if (app_context->movie != NULL) {
+                SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                            "Carregar estados fica desativado durante "
+                            "filmes\n");
+                return;
+        }
+        if (savestate_load(app_context->chip8, app_context->state_path)) {
+                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                            "Estado carregado: %s\n",
+                            app_context->state_path);
+        } else {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                             "Não foi possível carregar o estado: %s\n",
+                             app_context->state_path);
         }
-        SDL_SetRenderDrawColor(app_context->renderer, 51, 51, 51, 0xFF);
-        SDL_RenderClear(app_context->renderer);
+}
 
-        SDL_SetRenderDrawColor(app_context->renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+void render(AppContext *app_context) {
+        void *pixels;
+        int pitch;
+
+        if (!SDL_LockTexture(app_context->display_texture, NULL, &pixels,
+                             &pitch)) {
+                SDL_LogError(SDL_LOG_CATEGORY_RENDER,
+                             "Falha ao travar a textura: %s\n",
+                             SDL_GetError());
+                return;
+        }
 
-        SDL_LogTrace(SDL_LOG_CATEGORY_RENDER, "Renderizando %d pixels\n",
-                     n_pixels);
+        // Percorre a tela linha a linha, na mesma ordem da memória. Só a
+        // área da resolução atual é copiada e esticada para a janela.
+        const Chip8 *chip8 = app_context->chip8;
+        const uint8_t width = display_width(chip8);
+        const uint8_t height = display_height(chip8);
+        for (uint16_t y = 0; y < height; ++y) {
+                uint32_t *row = (uint32_t *)((uint8_t *)pixels + y * pitch);
+                for (uint16_t x = 0; x < width; ++x) {
+                        row[x] = display_pixel(chip8, x, y) ? PIXEL_ON_COLOR
+                                                            : PIXEL_OFF_COLOR;
+                }
+        }
+        SDL_UnlockTexture(app_context->display_texture);
 
-        SDL_RenderFillRects(app_context->renderer, app_context->display_pixels,
-                            n_pixels);
+        // Um único desenho escalado com vizinho mais próximo
+        const SDL_FRect source = {0, 0, width, height};
+        SDL_RenderTexture(app_context->renderer, app_context->display_texture,
+                          &source, NULL);
         SDL_RenderPresent(app_context->renderer);
 
         app_context->chip8->redraw = false;
@@ -201,16 +900,13 @@ void render(AppContext *app_context) {
 void load_instructions(Chip8 *chip8, char *filename) {
         uint8_t *program =
             malloc(sizeof(uint8_t) * (MEMORY_SIZE - PROGRAM_START));
-        size_t offset = 0;
-
+        // Só os bytes da ROM: um byte a mais mudaria o hash do estado
+        // gravado nos filmes
         FILE *fileptr = fopen(filename, "rb");
-        while (!feof(fileptr)) {
-                uint8_t byte;
-                fread(&byte, sizeof(uint8_t), 1, fileptr);
-                program[offset++] = byte;
-        }
+        const size_t size = fread(program, sizeof(uint8_t),
+                                  MEMORY_SIZE - PROGRAM_START, fileptr);
         fclose(fileptr);
 
-        init(chip8, program, offset);
+        init(chip8, program, size);
         free(program);
 }
\ No newline at end of file
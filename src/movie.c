@@ -0,0 +1,200 @@
+#include "movie.h"
+#include "savestate.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+uint64_t machine_hash(const Chip8 *chip8) {
+        uint8_t state[SAVESTATE_SIZE];
+        savestate_write(chip8, state);
+
+        uint64_t hash = 0xCBF29CE484222325;
+        for (size_t i = 0; i < sizeof(state); ++i) {
+                hash ^= state[i];
+                hash *= 0x100000001B3;
+        }
+        return hash;
+}
+
+static void add_input(Movie *movie, uint64_t cycle, uint16_t keys) {
+        if (movie->input_count == movie->input_capacity) {
+                movie->input_capacity =
+                    movie->input_capacity > 0 ? movie->input_capacity * 2 : 64;
+                movie->inputs =
+                    realloc(movie->inputs,
+                            movie->input_capacity * sizeof(MovieInput));
+        }
+        movie->inputs[movie->input_count++] = (MovieInput){cycle, keys};
+}
+
+static void add_checkpoint(Movie *movie, uint64_t cycle, uint64_t hash) {
+        if (movie->checkpoint_count == movie->checkpoint_capacity) {
+                movie->checkpoint_capacity =
+                    movie->checkpoint_capacity > 0
+                        ? movie->checkpoint_capacity * 2
+                        : 64;
+                movie->checkpoints =
+                    realloc(movie->checkpoints, movie->checkpoint_capacity *
+                                                    sizeof(MovieCheckpoint));
+        }
+        movie->checkpoints[movie->checkpoint_count++] =
+            (MovieCheckpoint){cycle, hash};
+}
+
+void movie_start(Movie *movie, const Chip8 *chip8,
+                 uint64_t checkpoint_interval) {
+        memset(movie, 0, sizeof(*movie));
+        movie->seed = chip8->random_seed;
+        movie->quirks = chip8->quirks;
+        movie->instructions_per_tick = chip8->instructions_per_tick;
+        movie->start_cycle = chip8->cycle_count;
+        movie->end_cycle = chip8->cycle_count;
+        movie->checkpoint_interval = checkpoint_interval;
+
+        // O primeiro checkpoint confere a ROM e o estado inicial
+        movie->next_checkpoint_cycle = chip8->cycle_count;
+        add_input(movie, chip8->cycle_count, chip8->keypad);
+        movie_record(movie, chip8);
+}
+
+void movie_record(Movie *movie, const Chip8 *chip8) {
+        const uint64_t cycle = chip8->cycle_count;
+        if (chip8->keypad != movie->inputs[movie->input_count - 1].keys) {
+                // Várias mudanças no mesmo ciclo: só a última vale
+                if (movie->inputs[movie->input_count - 1].cycle == cycle)
+                        movie->input_count--;
+                add_input(movie, cycle, chip8->keypad);
+        }
+        if (cycle >= movie->next_checkpoint_cycle) {
+                add_checkpoint(movie, cycle, machine_hash(chip8));
+                movie->next_checkpoint_cycle =
+                    cycle + movie->checkpoint_interval;
+        }
+        movie->end_cycle = cycle;
+}
+
+void movie_finish(Movie *movie, const Chip8 *chip8) {
+        movie->end_cycle = chip8->cycle_count;
+        if (movie->checkpoints[movie->checkpoint_count - 1].cycle !=
+            movie->end_cycle)
+                add_checkpoint(movie, movie->end_cycle, machine_hash(chip8));
+}
+
+MovieStatus movie_play(Movie *movie, Chip8 *chip8, uint32_t *budget) {
+        const uint64_t cycle = chip8->cycle_count;
+        while (movie->next_input < movie->input_count &&
+               movie->inputs[movie->next_input].cycle <= cycle) {
+                chip8->keypad = movie->inputs[movie->next_input].keys;
+                movie->next_input++;
+        }
+        while (movie->next_checkpoint < movie->checkpoint_count &&
+               movie->checkpoints[movie->next_checkpoint].cycle <= cycle) {
+                const MovieCheckpoint *checkpoint =
+                    &movie->checkpoints[movie->next_checkpoint];
+                if (checkpoint->cycle != cycle ||
+                    checkpoint->hash != machine_hash(chip8))
+                        return MOVIE_DESYNC;
+                movie->next_checkpoint++;
+        }
+        if (cycle >= movie->end_cycle)
+                return MOVIE_END;
+
+        uint64_t next_event = movie->end_cycle;
+        if (movie->next_input < movie->input_count &&
+            movie->inputs[movie->next_input].cycle < next_event)
+                next_event = movie->inputs[movie->next_input].cycle;
+        if (movie->next_checkpoint < movie->checkpoint_count &&
+            movie->checkpoints[movie->next_checkpoint].cycle < next_event)
+                next_event = movie->checkpoints[movie->next_checkpoint].cycle;
+        if (next_event - cycle < *budget)
+                *budget = (uint32_t)(next_event - cycle);
+        return MOVIE_PLAYING;
+}
+
+// Formato texto, uma linha por evento em ordem de ciclo:
+//
+//   C8MV 2
+//   seed <semente> ipt <instruções por tick> quirks <perfil>
+//   cycles <início> <fim>
+//   k <ciclo> <teclas em hexadecimal, bit N = tecla N>
+//   h <ciclo> <hash do estado em hexadecimal>
+bool movie_save(const Movie *movie, const char *path) {
+        FILE *file = fopen(path, "w");
+        if (file == NULL)
+                return false;
+
+        fprintf(file, "%s %d\n", MOVIE_MAGIC, MOVIE_VERSION);
+        fprintf(file, "seed %" PRIu64 " ipt %" PRIu32 " quirks %s\n",
+                movie->seed, movie->instructions_per_tick,
+                quirk_profile_name(movie->quirks));
+        fprintf(file, "cycles %" PRIu64 " %" PRIu64 "\n", movie->start_cycle,
+                movie->end_cycle);
+        size_t input = 0;
+        size_t checkpoint = 0;
+        while (input < movie->input_count ||
+               checkpoint < movie->checkpoint_count) {
+                if (checkpoint == movie->checkpoint_count ||
+                    (input < movie->input_count &&
+                     movie->inputs[input].cycle <=
+                         movie->checkpoints[checkpoint].cycle)) {
+                        fprintf(file, "k %" PRIu64 " %04X\n",
+                                movie->inputs[input].cycle,
+                                movie->inputs[input].keys);
+                        input++;
+                } else {
+                        fprintf(file, "h %" PRIu64 " %016" PRIX64 "\n",
+                                movie->checkpoints[checkpoint].cycle,
+                                movie->checkpoints[checkpoint].hash);
+                        checkpoint++;
+                }
+        }
+        return fclose(file) == 0;
+}
+
+bool movie_load(Movie *movie, const char *path) {
+        FILE *file = fopen(path, "r");
+        if (file == NULL)
+                return false;
+
+        memset(movie, 0, sizeof(*movie));
+        char magic[5];
+        int version;
+        char quirks[16];
+        if (fscanf(file, "%4s %d", magic, &version) != 2 ||
+            strcmp(magic, MOVIE_MAGIC) != 0 || version != MOVIE_VERSION ||
+            fscanf(file,
+                   " seed %" SCNu64 " ipt %" SCNu32 " quirks %15s"
+                   " cycles %" SCNu64 " %" SCNu64,
+                   &movie->seed, &movie->instructions_per_tick, quirks,
+                   &movie->start_cycle, &movie->end_cycle) != 5 ||
+            !parse_quirk_profile(quirks, &movie->quirks)) {
+                fclose(file);
+                return false;
+        }
+
+        char kind;
+        uint64_t cycle;
+        uint64_t value;
+        bool valid = true;
+        while (valid && fscanf(file, " %c %" SCNu64 " %" SCNx64, &kind,
+                               &cycle, &value) == 3) {
+                if (kind == 'k' && value <= 0xFFFF)
+                        add_input(movie, cycle, (uint16_t)value);
+                else if (kind == 'h')
+                        add_checkpoint(movie, cycle, value);
+                else
+                        valid = false;
+        }
+        valid = valid && feof(file);
+        fclose(file);
+        if (!valid)
+                movie_free(movie);
+        return valid;
+}
+
+void movie_free(Movie *movie) {
+        free(movie->inputs);
+        free(movie->checkpoints);
+        memset(movie, 0, sizeof(*movie));
+}
@@ -0,0 +1,78 @@
+#include "system.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#define MOVIE_MAGIC "C8MV"
+#define MOVIE_VERSION 2
+
+// Teclas pressionadas a partir de `cycle`
+typedef struct {
+        uint64_t cycle;
+        uint16_t keys;
+} MovieInput;
+
+// Hash do estado completo da máquina ao chegar em `cycle`
+typedef struct {
+        uint64_t cycle;
+        uint64_t hash;
+} MovieCheckpoint;
+
+typedef enum {
+        // Continua executando, até o limite devolvido por `movie_play()`
+        MOVIE_PLAYING,
+        // Chegou ao fim da gravação
+        MOVIE_END,
+        // O estado não bate com o gravado
+        MOVIE_DESYNC,
+} MovieStatus;
+
+// Entrada de uma execução, marcada pelo número de instruções executadas
+// (`cycle_count`), junto com a semente do CxNN, o perfil de quirks e o ritmo
+// dos timers. Como o núcleo é determinístico, isso basta para reproduzir a
+// execução inteira em qualquer núcleo e em qualquer velocidade. Os
+// checkpoints detectam quando a reprodução diverge da gravação.
+typedef struct {
+        uint64_t seed;
+        QuirkProfile quirks;
+        uint32_t instructions_per_tick;
+        uint64_t start_cycle;
+        uint64_t end_cycle;
+
+        MovieInput *inputs;
+        size_t input_count;
+        size_t input_capacity;
+        MovieCheckpoint *checkpoints;
+        size_t checkpoint_count;
+        size_t checkpoint_capacity;
+
+        // Gravação: instruções entre checkpoints e o próximo deles
+        uint64_t checkpoint_interval;
+        uint64_t next_checkpoint_cycle;
+        // Reprodução: próximos eventos a aplicar ou conferir
+        size_t next_input;
+        size_t next_checkpoint;
+} Movie;
+
+// Começa a gravar a partir do estado atual de `chip8`, com um checkpoint a
+// cada `checkpoint_interval` instruções
+void movie_start(Movie *movie, const Chip8 *chip8,
+                 uint64_t checkpoint_interval);
+// Registra o teclado e, quando for a hora, um checkpoint. Chamado entre os
+// lotes de instruções, sempre que a entrada pode ter mudado.
+void movie_record(Movie *movie, const Chip8 *chip8);
+// Encerra a gravação no ciclo atual, com um último checkpoint
+void movie_finish(Movie *movie, const Chip8 *chip8);
+// Aplica a entrada do ciclo atual e confere o checkpoint dele. Reduz
+// `budget` para não passar do próximo evento gravado.
+MovieStatus movie_play(Movie *movie, Chip8 *chip8, uint32_t *budget);
+bool movie_save(const Movie *movie, const char *path);
+bool movie_load(Movie *movie, const char *path);
+void movie_free(Movie *movie);
+// Hash FNV-1a do estado salvo da máquina
+uint64_t machine_hash(const Chip8 *chip8);
+
+#endif
@@ -0,0 +1,189 @@
+#include "rewind.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static_assert(SAVESTATE_SIZE <= 0xFFFF,
+              "Os trechos do RLE usam contadores de 16 bits");
+
+// RLE voltado para deltas: trechos de [zeros (u16)][literais (u16)][bytes].
+// Sequências de menos de 4 zeros ficam dentro dos literais, o que limita o
+// tamanho no pior caso a `REWIND_MAX_ENCODED_SIZE`.
+static size_t encode(const uint8_t *in, size_t size, uint8_t *out) {
+        size_t i = 0;
+        size_t o = 0;
+        while (i < size) {
+                const size_t zeros_start = i;
+                while (i < size && in[i] == 0) {
+                        i++;
+                }
+                const size_t literal_start = i;
+                while (i < size) {
+                        size_t zeros = 0;
+                        while (i + zeros < size && in[i + zeros] == 0 &&
+                               zeros < 4) {
+                                zeros++;
+                        }
+                        if (zeros == 4 || i + zeros == size)
+                                break;
+                        i += zeros > 0 ? zeros : 1;
+                }
+
+                const size_t zero_count = literal_start - zeros_start;
+                const size_t literal_count = i - literal_start;
+                out[o++] = zero_count & 0xFF;
+                out[o++] = zero_count >> 8;
+                out[o++] = literal_count & 0xFF;
+                out[o++] = literal_count >> 8;
+                memcpy(out + o, in + literal_start, literal_count);
+                o += literal_count;
+        }
+        return o;
+}
+
+// Decodifica sobre `out`: copiando o estado (keyframe) ou aplicando o XOR
+static void decode(const uint8_t *in, size_t size, uint8_t *out, bool xor) {
+        size_t i = 0;
+        size_t o = 0;
+        while (i < size) {
+                const size_t zero_count = in[i] | (in[i + 1] << 8);
+                const size_t literal_count = in[i + 2] | (in[i + 3] << 8);
+                i += 4;
+                if (!xor)
+                        memset(out + o, 0, zero_count);
+                o += zero_count;
+                if (xor) {
+                        for (size_t j = 0; j < literal_count; ++j) {
+                                out[o + j] ^= in[i + j];
+                        }
+                } else {
+                        memcpy(out + o, in + i, literal_count);
+                }
+                o += literal_count;
+                i += literal_count;
+        }
+}
+
+bool rewind_init(Rewind *rewind, size_t arena_size, uint32_t max_frames,
+                 uint32_t keyframe_interval) {
+        rewind->arena = malloc(arena_size);
+        rewind->entries = malloc(max_frames * sizeof(RewindEntry));
+        if (rewind->arena == NULL || rewind->entries == NULL ||
+            max_frames == 0) {
+                free(rewind->arena);
+                free(rewind->entries);
+                rewind->arena = NULL;
+                rewind->entries = NULL;
+                return false;
+        }
+        rewind->arena_size = arena_size;
+        rewind->max_entries = max_frames;
+        rewind->keyframe_interval = keyframe_interval;
+        rewind_clear(rewind);
+        return true;
+}
+
+void rewind_free(Rewind *rewind) {
+        free(rewind->arena);
+        free(rewind->entries);
+        rewind->arena = NULL;
+        rewind->entries = NULL;
+}
+
+void rewind_clear(Rewind *rewind) {
+        rewind->write = 0;
+        rewind->head = 0;
+        rewind->count = 0;
+        rewind->frames_since_keyframe = 0;
+        rewind->has_current = false;
+}
+
+static void drop_oldest(Rewind *rewind) {
+        rewind->head = (rewind->head + 1) % rewind->max_entries;
+        rewind->count--;
+}
+
+// Verdadeiro se há `size` bytes contíguos livres a partir de `write`, que
+// pode voltar para o início da arena
+static bool reserve(Rewind *rewind, size_t size) {
+        if (rewind->count == 0) {
+                rewind->write = 0;
+                return size <= rewind->arena_size;
+        }
+
+        // As entradas vivas ocupam [oldest, write), possivelmente dando a
+        // volta na arena
+        const size_t oldest = rewind->entries[rewind->head].offset;
+        if (rewind->write > oldest) {
+                if (rewind->arena_size - rewind->write >= size)
+                        return true;
+                if (oldest >= size) {
+                        rewind->write = 0;
+                        return true;
+                }
+                return false;
+        }
+        return oldest - rewind->write >= size;
+}
+
+void rewind_push(Rewind *rewind, const Chip8 *chip8) {
+        if (!rewind->has_current) {
+                savestate_write(chip8, rewind->current);
+                rewind->has_current = true;
+                return;
+        }
+
+        // `scratch` recebe o novo estado; a entrada guarda como voltar dele
+        // para `current`
+        savestate_write(chip8, rewind->scratch);
+        const bool keyframe =
+            rewind->frames_since_keyframe + 1 >= rewind->keyframe_interval;
+        if (!keyframe) {
+                for (size_t i = 0; i < SAVESTATE_SIZE; ++i) {
+                        rewind->current[i] ^= rewind->scratch[i];
+                }
+        }
+        const size_t size =
+            encode(rewind->current, SAVESTATE_SIZE, rewind->encoded);
+        memcpy(rewind->current, rewind->scratch, SAVESTATE_SIZE);
+
+        if (rewind->count == rewind->max_entries)
+                drop_oldest(rewind);
+        while (!reserve(rewind, size)) {
+                if (rewind->count == 0) {
+                        // Arena menor que uma entrada: não há histórico
+                        rewind->frames_since_keyframe = 0;
+                        return;
+                }
+                drop_oldest(rewind);
+        }
+
+        RewindEntry *entry =
+            &rewind->entries[(rewind->head + rewind->count) %
+                             rewind->max_entries];
+        entry->offset = rewind->write;
+        entry->size = size;
+        entry->keyframe = keyframe;
+        memcpy(rewind->arena + rewind->write, rewind->encoded, size);
+        rewind->write += size;
+        rewind->count++;
+        rewind->frames_since_keyframe =
+            keyframe ? 0 : rewind->frames_since_keyframe + 1;
+}
+
+bool rewind_pop(Rewind *rewind, Chip8 *chip8) {
+        if (rewind->count == 0)
+                return false;
+
+        const RewindEntry *entry =
+            &rewind->entries[(rewind->head + rewind->count - 1) %
+                             rewind->max_entries];
+        decode(rewind->arena + entry->offset, entry->size, rewind->current,
+               !entry->keyframe);
+        rewind->write = entry->offset;
+        rewind->count--;
+        if (rewind->frames_since_keyframe > 0)
+                rewind->frames_since_keyframe--;
+
+        return savestate_read(chip8, rewind->current, SAVESTATE_SIZE);
+}
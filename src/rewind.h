@@ -0,0 +1,57 @@
+#include "savestate.h"
+#include "system.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef REWIND_H
+#define REWIND_H
+
+// A cada quantos quadros um estado completo é guardado no lugar de um delta
+#define REWIND_KEYFRAME_INTERVAL 60
+// Pior caso da codificação de um estado, com o cabeçalho de cada trecho
+#define REWIND_MAX_ENCODED_SIZE (SAVESTATE_SIZE + 4 * (SAVESTATE_SIZE / 4 + 1))
+
+typedef struct {
+        uint32_t offset;
+        uint32_t size;
+        bool keyframe;
+} RewindEntry;
+
+// Histórico de quadros para voltar no tempo. Só o estado mais recente fica
+// completo; cada entrada guarda como voltar um quadro: o XOR entre o estado
+// seguinte e o anterior (quase todo zero) ou, nos keyframes, o estado
+// anterior inteiro, ambos comprimidos com RLE. As entradas ocupam uma arena
+// circular de tamanho fixo, descartando as mais antigas quando enche.
+typedef struct {
+        uint8_t *arena;
+        size_t arena_size;
+        // Próxima posição livre da arena
+        size_t write;
+
+        RewindEntry *entries;
+        uint32_t max_entries;
+        // Entrada mais antiga e quantidade de entradas
+        uint32_t head;
+        uint32_t count;
+        uint32_t keyframe_interval;
+        uint32_t frames_since_keyframe;
+
+        bool has_current;
+        uint8_t current[SAVESTATE_SIZE];
+        uint8_t scratch[SAVESTATE_SIZE];
+        uint8_t encoded[REWIND_MAX_ENCODED_SIZE];
+} Rewind;
+
+// Cria um histórico de até `max_frames` quadros usando no máximo
+// `arena_size` bytes para as entradas
+bool rewind_init(Rewind *rewind, size_t arena_size, uint32_t max_frames,
+                 uint32_t keyframe_interval);
+void rewind_free(Rewind *rewind);
+void rewind_clear(Rewind *rewind);
+// Guarda o estado atual como o quadro mais recente
+void rewind_push(Rewind *rewind, const Chip8 *chip8);
+// Volta um quadro. Falso se não há mais histórico.
+bool rewind_pop(Rewind *rewind, Chip8 *chip8);
+
+#endif
@@ -0,0 +1,168 @@
+#include "savestate.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+static_assert(SAVESTATE_OFFSET_STACK + STACK_DEPTH * 2 <=
+                  SAVESTATE_OFFSET_KEYPAD,
+              "A pilha não cabe no layout do estado");
+static_assert(SAVESTATE_OFFSET_RPL_FLAGS + RPL_FLAG_COUNT <=
+                  SAVESTATE_OFFSET_DISPLAY,
+              "As flags RPL não cabem no layout do estado");
+static_assert(MEMORY_SIZE <= SAVESTATE_MEMORY_SIZE,
+              "A memória não cabe no layout do estado");
+
+static void put_u16(uint8_t *out, uint16_t value) {
+        out[0] = value & 0xFF;
+        out[1] = value >> 8;
+}
+
+static void put_u32(uint8_t *out, uint32_t value) {
+        put_u16(out, value & 0xFFFF);
+        put_u16(out + 2, value >> 16);
+}
+
+static void put_u64(uint8_t *out, uint64_t value) {
+        put_u32(out, value & 0xFFFFFFFF);
+        put_u32(out + 4, value >> 32);
+}
+
+static uint16_t get_u16(const uint8_t *in) {
+        return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *in) {
+        return get_u16(in) | ((uint32_t)get_u16(in + 2) << 16);
+}
+
+static uint64_t get_u64(const uint8_t *in) {
+        return get_u32(in) | ((uint64_t)get_u32(in + 4) << 32);
+}
+
+void savestate_write(const Chip8 *chip8, uint8_t *buffer) {
+        memset(buffer, 0, SAVESTATE_SIZE);
+        memcpy(buffer, SAVESTATE_MAGIC, 4);
+        put_u16(buffer + SAVESTATE_OFFSET_VERSION, SAVESTATE_VERSION);
+
+        put_u16(buffer + SAVESTATE_OFFSET_PROGRAM_COUNTER,
+                chip8->program_counter);
+        put_u16(buffer + SAVESTATE_OFFSET_INDEX_REGISTER,
+                chip8->index_register);
+        buffer[SAVESTATE_OFFSET_STACK_POINTER] = chip8->stack_pointer;
+        buffer[SAVESTATE_OFFSET_DELAY_TIMER] = chip8->delay_timer;
+        buffer[SAVESTATE_OFFSET_SOUND_TIMER] = chip8->sound_timer;
+        buffer[SAVESTATE_OFFSET_HIRES] = chip8->hires;
+        memcpy(buffer + SAVESTATE_OFFSET_REGISTERS, chip8->registers,
+               REGISTER_COUNT);
+        for (uint8_t i = 0; i < STACK_DEPTH; ++i) {
+                put_u16(buffer + SAVESTATE_OFFSET_STACK + 2 * i,
+                        chip8->stack[i]);
+        }
+
+        put_u16(buffer + SAVESTATE_OFFSET_KEYPAD, chip8->keypad);
+        buffer[SAVESTATE_OFFSET_KEY_WAIT] = chip8->key_wait;
+        buffer[SAVESTATE_OFFSET_QUIRKS] = chip8->quirks;
+
+        put_u32(buffer + SAVESTATE_OFFSET_INSTRUCTIONS_PER_TICK,
+                chip8->instructions_per_tick);
+        put_u32(buffer + SAVESTATE_OFFSET_INSTRUCTIONS_UNTIL_TICK,
+                chip8->instructions_until_tick);
+        put_u64(buffer + SAVESTATE_OFFSET_CYCLE_COUNT, chip8->cycle_count);
+        put_u64(buffer + SAVESTATE_OFFSET_RANDOM_SEED, chip8->random_seed);
+        put_u64(buffer + SAVESTATE_OFFSET_RANDOM_STATE, chip8->random_state);
+        memcpy(buffer + SAVESTATE_OFFSET_RPL_FLAGS, chip8->rpl_flags,
+               RPL_FLAG_COUNT);
+        for (uint8_t y = 0; y < DISPLAY_HEIGHT; ++y) {
+                for (uint8_t w = 0; w < DISPLAY_WORDS; ++w) {
+                        put_u64(buffer + SAVESTATE_OFFSET_DISPLAY +
+                                    8 * (y * DISPLAY_WORDS + w),
+                                chip8->display[y][w]);
+                }
+        }
+        memcpy(buffer + SAVESTATE_OFFSET_MEMORY, chip8->memory, MEMORY_SIZE);
+}
+
+bool savestate_read(Chip8 *chip8, const uint8_t *buffer, size_t size) {
+        if (size != SAVESTATE_SIZE ||
+            memcmp(buffer, SAVESTATE_MAGIC, 4) != 0 ||
+            get_u16(buffer + SAVESTATE_OFFSET_VERSION) != SAVESTATE_VERSION ||
+            buffer[SAVESTATE_OFFSET_STACK_POINTER] > STACK_DEPTH ||
+            buffer[SAVESTATE_OFFSET_KEY_WAIT] > KEY_COUNT ||
+            buffer[SAVESTATE_OFFSET_HIRES] > 1 ||
+            buffer[SAVESTATE_OFFSET_QUIRKS] >= QUIRK_PROFILE_COUNT)
+                return false;
+
+        chip8->program_counter =
+            get_u16(buffer + SAVESTATE_OFFSET_PROGRAM_COUNTER);
+        chip8->index_register =
+            get_u16(buffer + SAVESTATE_OFFSET_INDEX_REGISTER);
+        chip8->stack_pointer = buffer[SAVESTATE_OFFSET_STACK_POINTER];
+        chip8->delay_timer = buffer[SAVESTATE_OFFSET_DELAY_TIMER];
+        chip8->sound_timer = buffer[SAVESTATE_OFFSET_SOUND_TIMER];
+        chip8->hires = buffer[SAVESTATE_OFFSET_HIRES];
+        memcpy(chip8->registers, buffer + SAVESTATE_OFFSET_REGISTERS,
+               REGISTER_COUNT);
+        for (uint8_t i = 0; i < STACK_DEPTH; ++i) {
+                chip8->stack[i] =
+                    get_u16(buffer + SAVESTATE_OFFSET_STACK + 2 * i);
+        }
+
+        chip8->keypad = get_u16(buffer + SAVESTATE_OFFSET_KEYPAD);
+        chip8->key_wait = buffer[SAVESTATE_OFFSET_KEY_WAIT];
+        chip8->quirks = buffer[SAVESTATE_OFFSET_QUIRKS];
+
+        chip8->instructions_per_tick =
+            get_u32(buffer + SAVESTATE_OFFSET_INSTRUCTIONS_PER_TICK);
+        chip8->instructions_until_tick =
+            get_u32(buffer + SAVESTATE_OFFSET_INSTRUCTIONS_UNTIL_TICK);
+        chip8->cycle_count = get_u64(buffer + SAVESTATE_OFFSET_CYCLE_COUNT);
+        chip8->random_seed = get_u64(buffer + SAVESTATE_OFFSET_RANDOM_SEED);
+        chip8->random_state = get_u64(buffer + SAVESTATE_OFFSET_RANDOM_STATE);
+        // A falha não faz parte do estado: carregar volta a executar, e a
+        // instrução que falhou falha de novo se for executada
+        chip8->trap = (Trap){FAULT_NONE, 0, 0};
+        // O PC carregado para no seu breakpoint, se houver
+        chip8->breakpoint_pc = NO_BREAKPOINT_PC;
+        memcpy(chip8->rpl_flags, buffer + SAVESTATE_OFFSET_RPL_FLAGS,
+               RPL_FLAG_COUNT);
+        for (uint8_t y = 0; y < DISPLAY_HEIGHT; ++y) {
+                for (uint8_t w = 0; w < DISPLAY_WORDS; ++w) {
+                        chip8->display[y][w] =
+                            get_u64(buffer + SAVESTATE_OFFSET_DISPLAY +
+                                    8 * (y * DISPLAY_WORDS + w));
+                }
+        }
+        memcpy(chip8->memory, buffer + SAVESTATE_OFFSET_MEMORY, MEMORY_SIZE);
+        chip8->redraw = true;
+
+        // A memória inteira mudou, e talvez o perfil de quirks: caches de
+        // instruções precisam saber
+        if (chip8->on_memory_write != NULL)
+                chip8->on_memory_write(chip8->memory_write_context, 0,
+                                       MEMORY_SIZE);
+        return true;
+}
+
+bool savestate_save(const Chip8 *chip8, const char *path) {
+        uint8_t buffer[SAVESTATE_SIZE];
+        savestate_write(chip8, buffer);
+
+        FILE *file = fopen(path, "wb");
+        if (file == NULL)
+                return false;
+        const bool written = fwrite(buffer, 1, SAVESTATE_SIZE, file) ==
+                             SAVESTATE_SIZE;
+        return fclose(file) == 0 && written;
+}
+
+bool savestate_load(Chip8 *chip8, const char *path) {
+        // Um byte a mais para detectar arquivos maiores que o esperado
+        uint8_t buffer[SAVESTATE_SIZE + 1];
+
+        FILE *file = fopen(path, "rb");
+        if (file == NULL)
+                return false;
+        const size_t size = fread(buffer, 1, sizeof(buffer), file);
+        fclose(file);
+        return savestate_read(chip8, buffer, size);
+}
@@ -0,0 +1,46 @@
+#include "system.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#define SAVESTATE_MAGIC "C8SS"
+#define SAVESTATE_VERSION 5
+
+// Layout fixo, little-endian, independente do layout de `Chip8` na memória
+#define SAVESTATE_OFFSET_VERSION 4
+#define SAVESTATE_OFFSET_PROGRAM_COUNTER 8
+#define SAVESTATE_OFFSET_INDEX_REGISTER 10
+#define SAVESTATE_OFFSET_STACK_POINTER 12
+#define SAVESTATE_OFFSET_DELAY_TIMER 13
+#define SAVESTATE_OFFSET_SOUND_TIMER 14
+#define SAVESTATE_OFFSET_HIRES 15
+#define SAVESTATE_OFFSET_REGISTERS 16
+#define SAVESTATE_OFFSET_STACK 32
+#define SAVESTATE_OFFSET_KEYPAD 64
+#define SAVESTATE_OFFSET_KEY_WAIT 66
+#define SAVESTATE_OFFSET_QUIRKS 67
+#define SAVESTATE_OFFSET_INSTRUCTIONS_PER_TICK 68
+#define SAVESTATE_OFFSET_INSTRUCTIONS_UNTIL_TICK 72
+#define SAVESTATE_OFFSET_CYCLE_COUNT 80
+#define SAVESTATE_OFFSET_RANDOM_SEED 88
+#define SAVESTATE_OFFSET_RANDOM_STATE 96
+#define SAVESTATE_OFFSET_RPL_FLAGS 104
+#define SAVESTATE_OFFSET_DISPLAY 120
+// Tela inteira de alta resolução, linha a linha, palavra a palavra
+#define SAVESTATE_OFFSET_MEMORY                                                \
+        (SAVESTATE_OFFSET_DISPLAY + DISPLAY_HEIGHT * DISPLAY_WORDS * 8)
+#define SAVESTATE_MEMORY_SIZE 0x1000
+#define SAVESTATE_SIZE (SAVESTATE_OFFSET_MEMORY + SAVESTATE_MEMORY_SIZE)
+
+// Serializa o estado da máquina em `SAVESTATE_SIZE` bytes
+void savestate_write(const Chip8 *chip8, uint8_t *buffer);
+// Restaura um estado serializado. Falha, sem alterar `chip8`, se o buffer
+// não for um estado válido desta versão.
+bool savestate_read(Chip8 *chip8, const uint8_t *buffer, size_t size);
+bool savestate_save(const Chip8 *chip8, const char *path);
+bool savestate_load(Chip8 *chip8, const char *path);
+
+#endif
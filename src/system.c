@@ -1,160 +1,226 @@
+#include "log.h"
 #include "system.h"
 #include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
-#ifndef NO_LOGGING
-#include "errors.h"
-#include <SDL3/SDL_log.h>
-#endif
 
 void __init_fonts(Chip8 *chip8);
 
-void clear_display(Chip8 *chip8) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION, "Limpando tela\n");
+static_assert((MEMORY_SIZE & ADDRESS_MASK) == 0,
+              "A máscara de endereços precisa de uma memória potência de 2");
+static_assert(offsetof(Chip8, trace) + sizeof(TraceBuffer *) <= 64,
+              "O estado quente precisa caber na primeira linha de cache");
+
+// Garante a especialização por perfil: o corpo do interpretador é copiado
+// em cada chamador, com as flags de quirks constantes
+#if defined(__GNUC__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
 #endif
-        for (int i = 0; i < DISPLAY_WIDTH * DISPLAY_HEIGHT; i++)
-                chip8->display[i] = 0;
+
+static inline void notify_memory_write(Chip8 *chip8, uint16_t address,
+                                       uint16_t length) {
+        if (chip8->on_memory_write == NULL)
+                return;
+        // Uma escrita que dá a volta no fim da memória vira dois trechos
+        const uint16_t first =
+            address + length > MEMORY_SIZE ? MEMORY_SIZE - address : length;
+        chip8->on_memory_write(chip8->memory_write_context, address, first);
+        if (first < length)
+                chip8->on_memory_write(chip8->memory_write_context, 0,
+                                       length - first);
+}
+
+// Instrução no endereço, ou 0 se ela não cabe na memória
+static inline uint16_t op_code_at(const Chip8 *chip8, uint16_t pc) {
+        if (pc >= MEMORY_SIZE - 1)
+                return 0;
+        return (uint16_t)(chip8->memory[pc] << 8) | chip8->memory[pc + 1];
+}
+
+// Marca a instância como parada na instrução atual. Quem chama retorna sem
+// alterar nenhum estado, e o `execute()` não avança o PC.
+static void raise_fault(Chip8 *chip8, Fault fault) {
+        chip8->trap.fault = fault;
+        chip8->trap.program_counter = chip8->program_counter;
+        chip8->trap.op_code = op_code_at(chip8, chip8->program_counter);
+}
+
+// PCG32 (XSH RR) com incremento fixo: qualquer estado é válido
+#define RANDOM_MULTIPLIER UINT64_C(6364136223846793005)
+#define RANDOM_INCREMENT UINT64_C(1442695040888963407)
+
+static inline uint32_t next_random(Chip8 *chip8) {
+        const uint64_t state = chip8->random_state;
+        chip8->random_state = state * RANDOM_MULTIPLIER + RANDOM_INCREMENT;
+        const uint32_t xorshifted = (uint32_t)(((state >> 18) ^ state) >> 27);
+        const uint32_t rotation = state >> 59;
+        return (xorshifted >> rotation) | (xorshifted << ((-rotation) & 31));
+}
+
+// Endereço `offset` bytes depois de I, dando a volta no fim da memória
+static inline uint16_t index_address(const Chip8 *chip8, uint16_t offset) {
+        return (chip8->index_register + offset) & ADDRESS_MASK;
+}
+
+void clear_display(Chip8 *chip8) {
+        LOG_TRACE("Limpando tela\n");
+        memset(chip8->display, 0, sizeof(chip8->display));
+}
+
+void scroll_down(Chip8 *chip8, uint8_t n) {
+        LOG_TRACE("Rolando a tela %d linhas para baixo\n", n);
+
+        const uint8_t height = display_height(chip8);
+        if (n > height)
+                n = height;
+        memmove(chip8->display[n], chip8->display[0],
+                (height - n) * sizeof(chip8->display[0]));
+        memset(chip8->display[0], 0, n * sizeof(chip8->display[0]));
+}
+
+// O bit mais significativo é a coluna 0: para a direita é `>>`, e os bits
+// que saem de uma palavra entram na seguinte
+void scroll_right(Chip8 *chip8) {
+        LOG_TRACE("Rolando a tela 4 pixels para a direita\n");
+
+        static_assert(DISPLAY_WORDS == 2,
+                      "A rolagem horizontal supõe linhas de 2 palavras");
+        const uint8_t height = display_height(chip8);
+        if (!chip8->hires) {
+                for (uint8_t y = 0; y < height; ++y)
+                        chip8->display[y][0] >>= 4;
+                return;
+        }
+        for (uint8_t y = 0; y < height; ++y) {
+                uint64_t *row = chip8->display[y];
+                row[1] = (row[1] >> 4) | (row[0] << 60);
+                row[0] >>= 4;
+        }
+}
+
+void scroll_left(Chip8 *chip8) {
+        LOG_TRACE("Rolando a tela 4 pixels para a esquerda\n");
+
+        const uint8_t height = display_height(chip8);
+        if (!chip8->hires) {
+                for (uint8_t y = 0; y < height; ++y)
+                        chip8->display[y][0] <<= 4;
+                return;
+        }
+        for (uint8_t y = 0; y < height; ++y) {
+                uint64_t *row = chip8->display[y];
+                row[0] = (row[0] << 4) | (row[1] >> 60);
+                row[1] <<= 4;
+        }
+}
+
+void set_hires(Chip8 *chip8, bool hires) {
+        LOG_TRACE("Trocando para %s resolução\n", hires ? "alta" : "baixa");
+
+        chip8->hires = hires;
+        clear_display(chip8);
 }
 
 void return_from_subroutine(Chip8 *chip8) {
-#ifndef NO_LOGGING
         if (chip8->stack_pointer > 0)
-                SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                             "Retornando para o endereço 0x%04X\n",
-                             chip8->stack[chip8->stack_pointer - 1]);
-#endif
+                LOG_TRACE("Retornando para o endereço 0x%04X\n",
+                          chip8->stack[chip8->stack_pointer - 1]);
 
         if (chip8->stack_pointer == 0) {
-#ifndef NO_LOGGING
-                log_error(STACK_UNDERFLOW);
-#endif
-                exit(EXIT_FAILURE);
+                raise_fault(chip8, FAULT_STACK_UNDERFLOW);
+                return;
         }
         chip8->stack_pointer--;
         chip8->program_counter = chip8->stack[chip8->stack_pointer];
 }
 
 void jump_to_address(Chip8 *chip8, uint16_t address) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Pulando para o endereço 0x%04X\n", address);
-#endif
+        LOG_TRACE("Pulando para o endereço 0x%04X\n", address);
 
         chip8->program_counter = address;
 }
 
 void call_subroutine(Chip8 *chip8, uint16_t address) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Chamando subrotina para o endereço 0x%04X\n", address);
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION, "Retornar para: 0x%04X\n",
-                     chip8->program_counter + 2);
-#endif
+        LOG_TRACE("Chamando subrotina para o endereço 0x%04X\n", address);
+        LOG_TRACE("Retornar para: 0x%04X\n", chip8->program_counter + 2);
 
         if (chip8->stack_pointer >= STACK_DEPTH - 1) {
-                exit(EXIT_FAILURE);
+                raise_fault(chip8, FAULT_STACK_OVERFLOW);
+                return;
         }
         chip8->stack[chip8->stack_pointer++] = chip8->program_counter + 2;
         chip8->program_counter = address;
 }
 
 void skip_if_equal(Chip8 *chip8, uint8_t reg, uint8_t value) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Pulando se V%X (0x%02X) == 0x%02X\n", reg,
-                     chip8->registers[reg], value);
-#endif
+        LOG_TRACE("Pulando se V%X (0x%02X) == 0x%02X\n", reg,
+                  chip8->registers[reg], value);
 
         chip8->program_counter += 2 * (chip8->registers[reg] == value);
 }
 
 void skip_if_not_equal(Chip8 *chip8, uint8_t reg, uint8_t value) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Pulando se V%X (0x%02X) != 0x%02X\n", reg,
-                     chip8->registers[reg], value);
-#endif
+        LOG_TRACE("Pulando se V%X (0x%02X) != 0x%02X\n", reg,
+                  chip8->registers[reg], value);
 
         chip8->program_counter += 2 * (chip8->registers[reg] != value);
 }
 
 void skip_if_equal_registers(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Pulando se V%X (0x%02X) == V%X (0x%02X)\n", reg_x,
-                     chip8->registers[reg_x], reg_y, chip8->registers[reg_y]);
-#endif
+        LOG_TRACE("Pulando se V%X (0x%02X) == V%X (0x%02X)\n", reg_x,
+                  chip8->registers[reg_x], reg_y, chip8->registers[reg_y]);
 
         chip8->program_counter +=
             2 * (chip8->registers[reg_x] == chip8->registers[reg_y]);
 }
 
 void set_register(Chip8 *chip8, uint8_t reg, uint8_t value) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION, "Definindo V%X = 0x%02X\n",
-                     reg, value);
-#endif
+        LOG_TRACE("Definindo V%X = 0x%02X\n", reg, value);
 
         chip8->registers[reg] = value;
 }
 
 void add_to_register(Chip8 *chip8, uint8_t reg, uint8_t value) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Adicionando 0x%02X ao V%X (0x%02X)\n", value, reg,
-                     chip8->registers[reg]);
-#endif
+        LOG_TRACE("Adicionando 0x%02X ao V%X (0x%02X)\n", value, reg,
+                  chip8->registers[reg]);
 
         chip8->registers[reg] += value;
 }
 void copy_register(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Copiando V%X = V%X (0x%02X)\n", reg_x, reg_y,
-                     chip8->registers[reg_y]);
-#endif
+        LOG_TRACE("Copiando V%X = V%X (0x%02X)\n", reg_x, reg_y,
+                  chip8->registers[reg_y]);
 
         chip8->registers[reg_x] = chip8->registers[reg_y];
 }
 
 void set_or(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Operação OR: V%X |= V%X (0x%02X | 0x%02X)\n", reg_x,
-                     reg_y, chip8->registers[reg_x], chip8->registers[reg_y]);
-#endif
+        LOG_TRACE("Operação OR: V%X |= V%X (0x%02X | 0x%02X)\n", reg_x, reg_y,
+                  chip8->registers[reg_x], chip8->registers[reg_y]);
 
         chip8->registers[reg_x] |= chip8->registers[reg_y];
 }
 
 void set_and(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Operação AND: V%X &= V%X (0x%02X & 0x%02X)\n", reg_x,
-                     reg_y, chip8->registers[reg_x], chip8->registers[reg_y]);
-#endif
+        LOG_TRACE("Operação AND: V%X &= V%X (0x%02X & 0x%02X)\n", reg_x, reg_y,
+                  chip8->registers[reg_x], chip8->registers[reg_y]);
 
         chip8->registers[reg_x] &= chip8->registers[reg_y];
 }
 
 void set_xor(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Operação XOR: V%X ^= V%X (0x%02X ^ 0x%02X)\n", reg_x,
-                     reg_y, chip8->registers[reg_x], chip8->registers[reg_y]);
-#endif
+        LOG_TRACE("Operação XOR: V%X ^= V%X (0x%02X ^ 0x%02X)\n", reg_x, reg_y,
+                  chip8->registers[reg_x], chip8->registers[reg_y]);
 
         chip8->registers[reg_x] ^= chip8->registers[reg_y];
 }
 
 void set_add(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Operação ADD: V%X += V%X (0x%02X + 0x%02X)\n", reg_x,
-                     reg_y, chip8->registers[reg_x], chip8->registers[reg_y]);
-#endif
+        LOG_TRACE("Operação ADD: V%X += V%X (0x%02X + 0x%02X)\n", reg_x, reg_y,
+                  chip8->registers[reg_x], chip8->registers[reg_y]);
 
         const bool carry =
             chip8->registers[reg_x] > (0xFF - chip8->registers[reg_y]);
@@ -163,11 +229,8 @@ void set_add(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y) {
 }
 
 void set_sub(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Operação SUB: V%X -= V%X (0x%02X - 0x%02X)\n", reg_x,
-                     reg_y, chip8->registers[reg_x], chip8->registers[reg_y]);
-#endif
+        LOG_TRACE("Operação SUB: V%X -= V%X (0x%02X - 0x%02X)\n", reg_x, reg_y,
+                  chip8->registers[reg_x], chip8->registers[reg_y]);
 
         const uint8_t v_x = chip8->registers[reg_x];
         const uint8_t v_y = chip8->registers[reg_y];
@@ -177,25 +240,19 @@ void set_sub(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y) {
         chip8->registers[0xF] = not_borrow;
 }
 
-void set_rshift(Chip8 *chip8, uint8_t reg_x) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Operação RSHIFT: V%X >>= 1 (0x%02X)\n", reg_x,
-                     chip8->registers[reg_x]);
-#endif
+void set_rshift(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y) {
+        LOG_TRACE("Operação RSHIFT: V%X = V%X >> 1 (0x%02X)\n", reg_x, reg_y,
+                  chip8->registers[reg_y]);
 
-        const bool carry = chip8->registers[reg_x] & 0x1;
-        chip8->registers[reg_x] >>= 1;
-        chip8->registers[0xF] = carry;
+        const uint8_t value = chip8->registers[reg_y];
+        chip8->registers[reg_x] = value >> 1;
+        chip8->registers[0xF] = value & 0x1;
 }
 
 void set_subn(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Operação SUBN: V%X = V%X - V%X (0x%02X - 0x%02X)\n",
-                     reg_x, reg_y, reg_x, chip8->registers[reg_y],
-                     chip8->registers[reg_x]);
-#endif
+        LOG_TRACE("Operação SUBN: V%X = V%X - V%X (0x%02X - 0x%02X)\n", reg_x,
+                  reg_y, reg_x, chip8->registers[reg_y],
+                  chip8->registers[reg_x]);
 
         const uint8_t v_x = chip8->registers[reg_x];
         const uint8_t v_y = chip8->registers[reg_y];
@@ -205,237 +262,237 @@ void set_subn(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y) {
         chip8->registers[0xF] = not_borrow;
 }
 
-void set_lshift(Chip8 *chip8, uint8_t reg) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Operação LSHIFT: V%X <<= 1 (0x%02X)\n", reg,
-                     chip8->registers[reg]);
-#endif
+void set_lshift(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y) {
+        LOG_TRACE("Operação LSHIFT: V%X = V%X << 1 (0x%02X)\n", reg_x, reg_y,
+                  chip8->registers[reg_y]);
 
-        const uint8_t old_value = chip8->registers[reg];
-        chip8->registers[reg] <<= 1;
-        chip8->registers[0xF] = old_value > 128;
+        const uint8_t value = chip8->registers[reg_y];
+        chip8->registers[reg_x] = value << 1;
+        chip8->registers[0xF] = value >> 7;
 }
 
 void skip_if_not_equal_registers(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Pulando se V%X != V%X (0x%02X != 0x%02X)\n", reg_x, reg_y,
-                     chip8->registers[reg_x], chip8->registers[reg_y]);
-#endif
+        LOG_TRACE("Pulando se V%X != V%X (0x%02X != 0x%02X)\n", reg_x, reg_y,
+                  chip8->registers[reg_x], chip8->registers[reg_y]);
 
         chip8->program_counter +=
             2 * (chip8->registers[reg_x] != chip8->registers[reg_y]);
 }
 
 void set_index_register(Chip8 *chip8, uint16_t address) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Definindo index para 0x%04X\n", address);
-#endif
-
-        if (address > 0xFFF) {
-#ifndef NO_LOGGING
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                             "Endereço inválido: 0x%04X\n", address);
-                exit(EXIT_FAILURE);
-#endif
-        }
+        LOG_TRACE("Definindo index para 0x%04X\n", address);
 
         chip8->index_register = address;
 }
 
-void jump_with_offset(Chip8 *chip8, uint16_t address) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Pulando para o endereço: 0x%04X + V0 (0x%02X)\n", address,
-                     chip8->registers[0]);
-#endif
+void jump_with_offset(Chip8 *chip8, uint16_t address, uint8_t reg) {
+        LOG_TRACE("Pulando para o endereço: 0x%04X + V%X (0x%02X)\n", address,
+                  reg, chip8->registers[reg]);
 
-        chip8->index_register = address + chip8->registers[0];
+        chip8->program_counter = address + chip8->registers[reg];
 }
 
 void set_random_and(Chip8 *chip8, uint8_t reg, uint8_t value) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Definindo V%X para aleatório AND 0x%02X\n", reg, value);
-#endif
+        LOG_TRACE("Definindo V%X para aleatório AND 0x%02X\n", reg, value);
 
-        chip8->registers[reg] = (uint8_t)rand() & value;
+        chip8->registers[reg] = (uint8_t)next_random(chip8) & value;
 }
 
-void draw_sprite(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y, uint8_t n) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(
-            SDL_LOG_CATEGORY_APPLICATION,
+static inline uint8_t sprite_byte(const Chip8 *chip8, uint8_t offset) {
+        return chip8->memory[index_address(chip8, offset)];
+}
+
+// A posição inicial sempre dá a volta na tela; o resto do sprite dá a volta
+// ou é cortado, conforme `clip`
+static ALWAYS_INLINE void draw(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y,
+                               uint8_t n, bool clip) {
+        LOG_TRACE(
             "Desenhando sprite em V%X,V%X (0x%02X,0x%02X) com altura %d\n",
             reg_x, reg_y, chip8->registers[reg_x], chip8->registers[reg_y], n);
-#endif
-
-        chip8->registers[0xF] = false;
-
-        for (uint8_t i = 0; i < n; ++i) {
-                const uint8_t sprite_byte =
-                    chip8->memory[chip8->index_register + i];
-                for (uint8_t j = 0; j < 8; ++j) {
-                        const bool sprite_bit = (sprite_byte >> (7 - j)) & 0x1;
 
-                        const uint8_t x =
-                            (chip8->registers[reg_x] + j) % DISPLAY_WIDTH;
-                        const uint8_t y =
-                            (chip8->registers[reg_y] + i) % DISPLAY_HEIGHT;
-
-                        const uint16_t index = y * DISPLAY_WIDTH + x;
-
-                        const bool prev_bit = chip8->display[index];
-
-                        chip8->display[index] ^= sprite_bit;
-                        // Colisão se o bit atual e anterior estão setados
-                        chip8->registers[0xF] =
-                            chip8->registers[0xF] || (prev_bit && sprite_bit);
+        const uint8_t width = display_width(chip8);
+        const uint8_t height = display_height(chip8);
+        const uint8_t x = chip8->registers[reg_x] % width;
+        const uint8_t top = chip8->registers[reg_y] % height;
+        // Dxy0 desenha 16x16, com 2 bytes por linha
+        const bool wide = n == 0;
+        uint8_t rows = wide ? 16 : n;
+        if (clip && rows > height - top)
+                rows = height - top;
+
+        // Cada linha do sprite cai numa palavra e no máximo transborda para
+        // a seguinte, que na borda da tela é a primeira da linha
+        const uint8_t word = x / 64;
+        const uint8_t shift = x % 64;
+        const uint8_t next = word + 1 < width / 64 ? word + 1 : 0;
+        const bool spill_visible = !clip || next != 0;
+        uint64_t collision = 0;
+
+        for (uint8_t i = 0; i < rows; ++i) {
+                const uint8_t y = (top + i) % height;
+                // Alinha a linha do sprite à coluna 0 da palavra
+                const uint8_t offset = wide ? 2 * i : i;
+                uint64_t sprite = (uint64_t)sprite_byte(chip8, offset) << 56;
+                if (wide)
+                        sprite |= (uint64_t)sprite_byte(chip8, offset + 1)
+                                  << 48;
+                const uint64_t first = sprite >> shift;
+                // Em dois passos, para que `shift` 0 não transborde nada
+                const uint64_t spill = (sprite << (63 - shift)) << 1;
+
+                // Colisão se algum bit estava setado e é setado de novo
+                uint64_t *row = chip8->display[y];
+                collision |= row[word] & first;
+                row[word] ^= first;
+                if (spill_visible) {
+                        collision |= row[next] & spill;
+                        row[next] ^= spill;
                 }
         }
 
+        chip8->registers[0xF] = collision != 0;
         chip8->redraw = true;
 }
 
-void skip_if_pressed(Chip8 *chip8, uint8_t key) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Pulando se tecla %X estiver pressionada\n", key);
-#endif
+void draw_sprite(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y, uint8_t n) {
+        draw(chip8, reg_x, reg_y, n, false);
+}
 
-        chip8->program_counter += 2 * chip8->keypad[key];
+void draw_sprite_clipped(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y,
+                         uint8_t n) {
+        draw(chip8, reg_x, reg_y, n, true);
 }
 
-void skip_if_not_pressed(Chip8 *chip8, uint8_t key) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Pulando se tecla %X não estiver pressionada\n", key);
-#endif
+void skip_if_pressed(Chip8 *chip8, uint8_t reg) {
+        LOG_TRACE("Pulando se a tecla em V%X estiver pressionada\n", reg);
+
+        chip8->program_counter += 2 * key_pressed(chip8, chip8->registers[reg]);
+}
 
-        chip8->program_counter += 2 * !chip8->keypad[key];
+void skip_if_not_pressed(Chip8 *chip8, uint8_t reg) {
+        LOG_TRACE("Pulando se a tecla em V%X não estiver pressionada\n", reg);
+
+        chip8->program_counter +=
+            2 * !key_pressed(chip8, chip8->registers[reg]);
 }
 
 void load_delay_timer_to_register(Chip8 *chip8, uint8_t reg) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Carregando delay timer para V%X\n", reg);
-#endif
+        LOG_TRACE("Carregando delay timer para V%X\n", reg);
         chip8->registers[reg] = chip8->delay_timer;
 }
 
 void load_sound_timer_to_register(Chip8 *chip8, uint8_t reg) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Carregando sound timer para V%X\n", reg);
-#endif
+        LOG_TRACE("Carregando sound timer para V%X\n", reg);
 
         chip8->registers[reg] = chip8->sound_timer;
 }
 
+// Como no COSMAC VIP, a tecla só é entregue quando é solta
 bool load_key_to_register(Chip8 *chip8, uint8_t reg) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Aguardando tecla para carregar em V%X\n", reg);
-#endif
-
-        for (uint8_t i = 0; i < 16; ++i) {
-                if (chip8->keypad[i]) {
-                        chip8->registers[reg] = i;
-                        return true;
+        LOG_TRACE("Aguardando tecla para carregar em V%X\n", reg);
+
+        if (chip8->key_wait == 0) {
+                for (uint8_t i = 0; i < KEY_COUNT; ++i) {
+                        if (key_pressed(chip8, i)) {
+                                chip8->key_wait = i + 1;
+                                break;
+                        }
                 }
+                return false;
         }
-        return false;
+
+        const uint8_t key = chip8->key_wait - 1;
+        if (key_pressed(chip8, key))
+                return false;
+        chip8->registers[reg] = key;
+        chip8->key_wait = 0;
+        return true;
 }
 
 void set_delay_timer(Chip8 *chip8, uint8_t reg) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Definindo delay timer com valor de V%X (0x%02X)\n", reg,
-                     chip8->registers[reg]);
-#endif
+        LOG_TRACE("Definindo delay timer com valor de V%X (0x%02X)\n", reg,
+                  chip8->registers[reg]);
 
         chip8->delay_timer = chip8->registers[reg];
 }
 
 void set_sound_timer(Chip8 *chip8, uint8_t reg) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Definindo sound timer com valor de V%X (0x%02X)\n", reg,
-                     chip8->registers[reg]);
-#endif
+        LOG_TRACE("Definindo sound timer com valor de V%X (0x%02X)\n", reg,
+                  chip8->registers[reg]);
 
         chip8->sound_timer = chip8->registers[reg];
 }
 
 void offset_index_register(Chip8 *chip8, uint8_t reg) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Incrementando I com valor de V%X (0x%02X)\n", reg,
-                     chip8->registers[reg]);
-#endif
+        LOG_TRACE("Incrementando I com valor de V%X (0x%02X)\n", reg,
+                  chip8->registers[reg]);
 
         chip8->index_register += chip8->registers[reg];
 }
 
 void load_sprite_font(Chip8 *chip8, uint8_t reg) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Carregando sprite de V%X em I\n", reg);
-#endif
+        LOG_TRACE("Carregando sprite de V%X em I\n", reg);
 
         chip8->index_register = FONTSET_START + chip8->registers[reg] * 5;
 }
 
+void load_big_sprite_font(Chip8 *chip8, uint8_t reg) {
+        LOG_TRACE("Carregando sprite grande de V%X em I\n", reg);
+
+        chip8->index_register = BIG_FONTSET_START +
+                                (chip8->registers[reg] & 0xF) *
+                                    BIG_FONT_SPRITE_SIZE;
+}
+
 void store_bcd(Chip8 *chip8, uint8_t reg) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Armazenando BCD de V%X (%03d)\n", reg,
-                     chip8->registers[reg]);
-#endif
+        LOG_TRACE("Armazenando BCD de V%X (%03d)\n", reg,
+                  chip8->registers[reg]);
         uint8_t val = chip8->registers[reg];
         for (uint16_t i = 0; i <= 2; i++) {
-                const uint16_t index = chip8->index_register + (2 - i);
+                const uint16_t index = index_address(chip8, 2 - i);
                 chip8->memory[index] = val % 10;
-#ifndef NO_LOGGING
-                SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                             "Armazenando %d em 0x%02X\n", chip8->memory[index],
-                             index);
-#endif
+                LOG_TRACE("Armazenando %d em 0x%02X\n", chip8->memory[index],
+                          index);
                 val /= 10;
         }
+        notify_memory_write(chip8, index_address(chip8, 0), 3);
 }
 
 void store_registers(Chip8 *chip8, uint8_t reg_stop) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Armazenando registradores de V0 até V%X\n", reg_stop);
-#endif
-
+        LOG_TRACE("Armazenando registradores de V0 até V%X\n", reg_stop);
         for (uint16_t i = 0; i <= reg_stop; ++i) {
-                chip8->memory[chip8->index_register + i] = chip8->registers[i];
+                chip8->memory[index_address(chip8, i)] = chip8->registers[i];
         }
+        notify_memory_write(chip8, index_address(chip8, 0), reg_stop + 1);
 }
 
 void load_to_registers(Chip8 *chip8, uint8_t reg_stop) {
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION,
-                     "Carregando registradores de V0 até V%X\n", reg_stop);
-#endif
-
+        LOG_TRACE("Carregando registradores de V0 até V%X\n", reg_stop);
         for (uint16_t i = 0; i <= reg_stop; ++i) {
-                chip8->registers[i] = chip8->memory[chip8->index_register + i];
+                chip8->registers[i] = chip8->memory[index_address(chip8, i)];
         }
 }
 
+void store_rpl_flags(Chip8 *chip8, uint8_t reg_stop) {
+        LOG_TRACE("Armazenando V0 até V%X nas flags RPL\n", reg_stop);
+        memcpy(chip8->rpl_flags, chip8->registers, reg_stop + 1);
+}
+
+void load_rpl_flags(Chip8 *chip8, uint8_t reg_stop) {
+        LOG_TRACE("Carregando V0 até V%X das flags RPL\n", reg_stop);
+        memcpy(chip8->registers, chip8->rpl_flags, reg_stop + 1);
+}
+
 void init(Chip8 *chip8, uint8_t *program, size_t program_size) {
         reset(chip8);
+        memset(chip8->rpl_flags, 0, sizeof(chip8->rpl_flags));
 
         memcpy((void *)&chip8->memory[PROGRAM_START], program, program_size);
 
         clear_display(chip8);
         __init_fonts(chip8);
+        // Programa e fontes novos: caches de instruções precisam saber
+        notify_memory_write(chip8, 0, MEMORY_SIZE);
 }
 
 void reset(Chip8 *chip8) {
@@ -444,6 +501,12 @@ void reset(Chip8 *chip8) {
         chip8->delay_timer = 0;
         chip8->sound_timer = 0;
         chip8->stack_pointer = 0;
+        chip8->cycle_count = 0;
+        chip8->instructions_until_tick = chip8->instructions_per_tick;
+        chip8->trap = (Trap){FAULT_NONE, 0, 0};
+        chip8->breakpoint_pc = NO_BREAKPOINT_PC;
+        chip8->hires = false;
+        set_random_seed(chip8, chip8->random_seed);
 
         for (uint8_t i = 0; i < REGISTER_COUNT; i++) {
                 chip8->registers[i] = 0;
@@ -451,22 +514,30 @@ void reset(Chip8 *chip8) {
         for (uint8_t i = 0; i < STACK_DEPTH; i++) {
                 chip8->stack[i] = 0;
         }
-        for (uint8_t i = 0; i < KEY_COUNT; i++) {
-                chip8->keypad[i] = false;
-        }
+        chip8->keypad = 0;
+        chip8->key_wait = 0;
         for (uint16_t i = 0; i < MEMORY_SIZE; i++) {
                 chip8->memory[i] = 0;
         }
+        notify_memory_write(chip8, 0, MEMORY_SIZE);
 }
-void step(Chip8 *chip8) {
+
+// Corpo do interpretador, especializado para cada perfil por `SPECIALIZE`.
+// Com `quirks` constante, os testes de quirks somem na compilação.
+static ALWAYS_INLINE void execute_quirks(Chip8 *chip8, const uint8_t quirks) {
+        if (chip8->trap.fault != FAULT_NONE)
+                return;
+        if (chip8->program_counter >= MEMORY_SIZE - 1) {
+                raise_fault(chip8, FAULT_INVALID_ADDRESS);
+                return;
+        }
+
         const Instruction instruction = {
             chip8->memory[chip8->program_counter],
             chip8->memory[chip8->program_counter + 1]};
 
-#ifndef NO_LOGGING
-        SDL_LogTrace(SDL_LOG_CATEGORY_APPLICATION, "0x%04X: 0x%02X 0x%02X\n",
-                     chip8->program_counter, instruction[0], instruction[1]);
-#endif
+        LOG_TRACE("0x%04X: 0x%02X 0x%02X\n", chip8->program_counter,
+                  instruction[0], instruction[1]);
 
         bool advance_pc = true;
 
@@ -490,7 +561,29 @@ void step(Chip8 *chip8) {
                         return_from_subroutine(chip8);
                         advance_pc = false;
                         break;
+                case 0xFB:
+                        scroll_right(chip8);
+                        break;
+                case 0xFC:
+                        scroll_left(chip8);
+                        break;
+                case 0xFD:
+                        // Saída do SUPER-CHIP: a instância para aqui
+                        advance_pc = false;
+                        break;
+                case 0xFE:
+                        set_hires(chip8, false);
+                        break;
+                case 0xFF:
+                        set_hires(chip8, true);
+                        break;
+                default:
+                        if ((second_byte & 0xF0) == 0xC0)
+                                scroll_down(chip8, last_nibble);
+                        break;
                 }
+                // Demais 0NNN chamariam código nativo do COSMAC VIP e são
+                // ignoradas, como nos outros interpretadores
                 break;
         case 0x1:
                 jump_to_address(chip8, address);
@@ -522,12 +615,18 @@ void step(Chip8 *chip8) {
                         break;
                 case 0x1:
                         set_or(chip8, v_x, v_y);
+                        if (quirks & QUIRK_VF_RESET)
+                                reset_flag(chip8);
                         break;
                 case 0x2:
                         set_and(chip8, v_x, v_y);
+                        if (quirks & QUIRK_VF_RESET)
+                                reset_flag(chip8);
                         break;
                 case 0x3:
                         set_xor(chip8, v_x, v_y);
+                        if (quirks & QUIRK_VF_RESET)
+                                reset_flag(chip8);
                         break;
                 case 0x4:
                         set_add(chip8, v_x, v_y);
@@ -536,13 +635,18 @@ void step(Chip8 *chip8) {
                         set_sub(chip8, v_x, v_y);
                         break;
                 case 0x6:
-                        set_rshift(chip8, v_x);
+                        set_rshift(chip8, v_x,
+                                   quirks & QUIRK_SHIFT_VX ? v_x : v_y);
                         break;
                 case 0x7:
                         set_subn(chip8, v_x, v_y);
                         break;
                 case 0xE:
-                        set_lshift(chip8, v_x);
+                        set_lshift(chip8, v_x,
+                                   quirks & QUIRK_SHIFT_VX ? v_x : v_y);
+                        break;
+                default:
+                        raise_fault(chip8, FAULT_INVALID_INSTRUCTION);
                         break;
                 }
                 break;
@@ -553,23 +657,29 @@ void step(Chip8 *chip8) {
                 set_index_register(chip8, address);
                 break;
         case 0xB:
-                jump_with_offset(chip8, address);
+                jump_with_offset(chip8, address,
+                                 quirks & QUIRK_JUMP_VX ? v_x : 0);
+                advance_pc = false;
                 break;
         case 0xC:
                 set_random_and(chip8, v_x, second_byte);
                 break;
         case 0xD:
-                draw_sprite(chip8, v_x, v_y, last_nibble);
+                if (quirks & QUIRK_CLIP)
+                        draw_sprite_clipped(chip8, v_x, v_y, last_nibble);
+                else
+                        draw_sprite(chip8, v_x, v_y, last_nibble);
                 break;
         case 0xE:
                 switch (second_byte) {
                 case 0x9E:
                         skip_if_pressed(chip8, v_x);
-                        reset_keys(chip8);
                         break;
                 case 0xA1:
                         skip_if_not_pressed(chip8, v_x);
-                        reset_keys(chip8);
+                        break;
+                default:
+                        raise_fault(chip8, FAULT_INVALID_INSTRUCTION);
                         break;
                 }
                 break;
@@ -580,7 +690,6 @@ void step(Chip8 *chip8) {
                         break;
                 case 0xA:
                         advance_pc = load_key_to_register(chip8, v_x);
-                        reset_keys(chip8);
                         break;
                 case 0x15:
                         set_delay_timer(chip8, v_x);
@@ -594,23 +703,36 @@ void step(Chip8 *chip8) {
                 case 0x29:
                         load_sprite_font(chip8, v_x);
                         break;
+                case 0x30:
+                        load_big_sprite_font(chip8, v_x);
+                        break;
                 case 0x33:
                         store_bcd(chip8, v_x);
                         break;
                 case 0x55:
                         store_registers(chip8, v_x);
+                        if (quirks & QUIRK_MEMORY_INCREMENT)
+                                increment_index(chip8, v_x);
                         break;
                 case 0x65:
                         load_to_registers(chip8, v_x);
+                        if (quirks & QUIRK_MEMORY_INCREMENT)
+                                increment_index(chip8, v_x);
+                        break;
+                case 0x75:
+                        store_rpl_flags(chip8, v_x);
+                        break;
+                case 0x85:
+                        load_rpl_flags(chip8, v_x);
+                        break;
+                default:
+                        raise_fault(chip8, FAULT_INVALID_INSTRUCTION);
                         break;
                 }
                 break;
-        default:
-#ifndef NO_LOGGING
-                log_error(INVALID_INSTRUCTION);
-#endif
-                exit(EXIT_FAILURE);
         }
+        if (chip8->trap.fault != FAULT_NONE)
+                return;
         chip8->program_counter += 2 * advance_pc;
 
 #ifdef DEBUG
@@ -643,10 +765,344 @@ void step(Chip8 *chip8) {
 #endif
 }
 
-void reset_keys(Chip8 *chip8) {
-        for (uint8_t i = 0; i < 16; ++i) {
-                chip8->keypad[i] = false;
+// Executa uma instrução e grava o resultado no trace. O registrador alterado
+// é descoberto comparando os registradores antes e depois, sem depender do
+// tipo da instrução.
+static void execute_traced(Chip8 *chip8) {
+        uint8_t before[REGISTER_COUNT];
+        memcpy(before, chip8->registers, sizeof(before));
+
+        const uint16_t pc = chip8->program_counter;
+        TraceRecord record;
+        record.program_counter = pc;
+        record.op_code = op_code_at(chip8, pc);
+
+        execute(chip8);
+        if (chip8->trap.fault != FAULT_NONE)
+                return;
+
+        record.index_register = chip8->index_register;
+        record.changed_register = TRACE_NO_REGISTER;
+        record.changed_value = 0;
+        record.flag = chip8->registers[0xF];
+        record.reserved = 0;
+        if (memcmp(before, chip8->registers, sizeof(before)) != 0) {
+                for (uint8_t i = 0; i < REGISTER_COUNT; ++i) {
+                        if (before[i] != chip8->registers[i]) {
+                                record.changed_register = i;
+                                record.changed_value = chip8->registers[i];
+                                if (i != 0xF)
+                                        break;
+                        }
+                }
+        }
+        trace_record(chip8->trace, &record);
+}
+
+Fault step(Chip8 *chip8) {
+        if (chip8->trace != NULL) {
+                execute_traced(chip8);
+        } else {
+                execute(chip8);
+        }
+        if (chip8->trap.fault != FAULT_NONE)
+                return chip8->trap.fault;
+        advance_cycles(chip8, 1);
+        return FAULT_NONE;
+}
+
+// 00E0, as rolagens e as trocas de resolução
+static inline bool changes_display(uint16_t op_code) {
+        switch (op_code) {
+        case 0x00E0:
+        case 0x00FB:
+        case 0x00FC:
+        case 0x00FE:
+        case 0x00FF:
+                return true;
+        }
+        return (op_code & 0xFFF0) == 0x00C0;
+}
+
+// Evento causado pela instrução `op_code`, que estava em `pc` e acabou de
+// ser executada
+static inline RunReason event_after(const Chip8 *chip8, uint16_t op_code,
+                                    uint16_t pc) {
+        switch (op_code >> 12) {
+        case 0x0:
+                return changes_display(op_code) ? RUN_DISPLAY : RUN_BUDGET;
+        case 0xD:
+                return RUN_DISPLAY;
+        case 0xF:
+                if ((op_code & 0xFF) == 0x0A && chip8->program_counter == pc)
+                        return RUN_WAITING_KEY;
+                if ((op_code & 0xFF) == 0x18 && chip8->sound_timer > 0)
+                        return RUN_SOUND;
+                break;
+        }
+        return RUN_BUDGET;
+}
+
+static ALWAYS_INLINE RunReason run_quirks(Chip8 *chip8, uint32_t max_cycles,
+                                          const uint8_t quirks) {
+        uint32_t executed = 0;
+        while (executed < max_cycles) {
+                // O relógio só avança entre trechos que não cruzam um tick
+                const uint32_t chunk =
+                    instructions_before_tick(chip8, max_cycles - executed);
+                RunReason reason = RUN_BUDGET;
+                uint32_t count = 0;
+                while (count < chunk) {
+                        const uint16_t pc = chip8->program_counter;
+                        if (chip8->breakpoints != NULL) {
+                                // Na volta, só a instrução do breakpoint onde
+                                // parou executa; o host pode ter movido o PC
+                                const bool resume = chip8->breakpoint_pc == pc;
+                                chip8->breakpoint_pc = NO_BREAKPOINT_PC;
+                                if (!resume &&
+                                    has_breakpoint(chip8->breakpoints, pc)) {
+                                        chip8->breakpoint_pc = pc;
+                                        reason = RUN_BREAKPOINT;
+                                        break;
+                                }
+                        }
+
+                        const uint16_t op_code = op_code_at(chip8, pc);
+                        if (chip8->trace != NULL) {
+                                execute_traced(chip8);
+                        } else {
+                                execute_quirks(chip8, quirks);
+                        }
+                        if (chip8->trap.fault != FAULT_NONE) {
+                                reason = RUN_FAULT;
+                                break;
+                        }
+                        count++;
+                        reason = event_after(chip8, op_code, pc);
+                        if (reason != RUN_BUDGET)
+                                break;
+                        // Um salto pode levar a um laço de espera
+                        if ((op_code >> 12) == 0x1)
+                                count += skip_idle_loop(chip8, chunk - count);
+                }
+                advance_cycles(chip8, count);
+                executed += count;
+                if (reason != RUN_BUDGET)
+                        return reason;
         }
+        return RUN_BUDGET;
+}
+
+// Uma cópia de `execute()` e de `run()` por perfil
+#define SPECIALIZE(name, flags)                                                \
+        static void execute_##name(Chip8 *chip8) {                             \
+                execute_quirks(chip8, flags);                                  \
+        }                                                                      \
+        static RunReason run_##name(Chip8 *chip8, uint32_t max_cycles) {       \
+                return run_quirks(chip8, max_cycles, flags);                   \
+        }
+
+SPECIALIZE(chip8, QUIRKS_CHIP8_FLAGS)
+SPECIALIZE(schip, QUIRKS_SCHIP_FLAGS)
+SPECIALIZE(xochip, QUIRKS_XOCHIP_FLAGS)
+
+void execute(Chip8 *chip8) {
+        switch (chip8->quirks) {
+        case QUIRKS_SCHIP:
+                execute_schip(chip8);
+                break;
+        case QUIRKS_XOCHIP:
+                execute_xochip(chip8);
+                break;
+        default:
+                execute_chip8(chip8);
+                break;
+        }
+}
+
+RunReason run(Chip8 *chip8, uint32_t max_cycles) {
+        switch (chip8->quirks) {
+        case QUIRKS_SCHIP:
+                return run_schip(chip8, max_cycles);
+        case QUIRKS_XOCHIP:
+                return run_xochip(chip8, max_cycles);
+        default:
+                return run_chip8(chip8, max_cycles);
+        }
+}
+
+const char *fault_name(Fault fault) {
+        switch (fault) {
+        case FAULT_NONE:
+                return "none";
+        case FAULT_STACK_OVERFLOW:
+                return "stack_overflow";
+        case FAULT_STACK_UNDERFLOW:
+                return "stack_underflow";
+        case FAULT_INVALID_INSTRUCTION:
+                return "invalid_instruction";
+        case FAULT_INVALID_ADDRESS:
+                return "invalid_address";
+        }
+        return "unknown";
+}
+
+static const char *const QUIRK_PROFILE_NAMES[QUIRK_PROFILE_COUNT] = {
+    [QUIRKS_CHIP8] = "chip8",
+    [QUIRKS_SCHIP] = "schip",
+    [QUIRKS_XOCHIP] = "xochip",
+};
+
+const char *quirk_profile_name(QuirkProfile profile) {
+        if (profile >= QUIRK_PROFILE_COUNT)
+                return "unknown";
+        return QUIRK_PROFILE_NAMES[profile];
+}
+
+bool parse_quirk_profile(const char *name, QuirkProfile *profile) {
+        for (uint8_t i = 0; i < QUIRK_PROFILE_COUNT; ++i) {
+                if (strcmp(name, QUIRK_PROFILE_NAMES[i]) == 0) {
+                        *profile = i;
+                        return true;
+                }
+        }
+        return false;
+}
+
+void set_quirk_profile(Chip8 *chip8, QuirkProfile profile) {
+        chip8->quirks = profile;
+        notify_memory_write(chip8, 0, MEMORY_SIZE);
+}
+
+void tick_timers(Chip8 *chip8) {
+        if (chip8->delay_timer > 0)
+                chip8->delay_timer--;
+        if (chip8->sound_timer > 0)
+                chip8->sound_timer--;
+}
+
+// Inicialização padrão do PCG32: a semente entra entre dois passos, para
+// que sementes próximas não comecem com saídas parecidas
+void set_random_seed(Chip8 *chip8, uint64_t seed) {
+        chip8->random_seed = seed;
+        chip8->random_state = 0;
+        next_random(chip8);
+        chip8->random_state += seed;
+        next_random(chip8);
+}
+
+void set_instructions_per_tick(Chip8 *chip8, uint32_t instructions_per_tick) {
+        chip8->instructions_per_tick = instructions_per_tick;
+        chip8->instructions_until_tick = instructions_per_tick;
+}
+
+void advance_cycles(Chip8 *chip8, uint32_t count) {
+        chip8->cycle_count += count;
+        if (chip8->instructions_per_tick == 0)
+                return;
+
+        while (count >= chip8->instructions_until_tick) {
+                count -= chip8->instructions_until_tick;
+                chip8->instructions_until_tick = chip8->instructions_per_tick;
+                tick_timers(chip8);
+        }
+        chip8->instructions_until_tick -= count;
+}
+
+// Laços que só esperam o tempo passar, começando no PC:
+//   1NNN para o próprio endereço;
+//   Fx0A bloqueado, até o teclado mudar;
+//   00FD, para sempre;
+//   Fx07, 3x00, 1NNN de volta ao Fx07, enquanto DT não chega a zero;
+//   Fx07, 4x00, (pulada), 1NNN de volta ao Fx07, idem.
+uint8_t idle_loop_length(const Chip8 *chip8) {
+        const uint16_t pc = chip8->program_counter;
+        const uint16_t jump_back = 0x1000 | pc;
+        const uint16_t first = op_code_at(chip8, pc);
+        if (first == jump_back || first == 0x00FD || waiting_for_key(chip8))
+                return 1;
+        if ((first & 0xF0FF) != 0xF007 || chip8->delay_timer == 0)
+                return 0;
+
+        const uint16_t reg = first & 0x0F00;
+        const uint16_t test = op_code_at(chip8, pc + 2);
+        if (test == (0x3000 | reg) && op_code_at(chip8, pc + 4) == jump_back)
+                return 3;
+        if (test == (0x4000 | reg) && op_code_at(chip8, pc + 6) == jump_back)
+                return 3;
+        return 0;
+}
+
+// Entre dois ticks o DT não muda, então cada volta deixa a máquina igual:
+// basta contar as instruções e deixar em Vx o valor que o Fx07 leria
+uint32_t skip_idle_loop(Chip8 *chip8, uint32_t budget) {
+        // O trace e os breakpoints precisam ver cada instrução
+        if (chip8->trace != NULL || chip8->breakpoints != NULL)
+                return 0;
+        const uint8_t length = idle_loop_length(chip8);
+        if (length == 0)
+                return 0;
+
+        const uint32_t skipped = budget - budget % length;
+        if (skipped > 0 && length > 1) {
+                const uint8_t reg = chip8->memory[chip8->program_counter] & 0xF;
+                chip8->registers[reg] = chip8->delay_timer;
+        }
+        return skipped;
+}
+
+uint32_t run_idle_loop(Chip8 *chip8, uint32_t budget) {
+        uint32_t skipped = 0;
+        while (skipped < budget) {
+                const uint32_t count = skip_idle_loop(
+                    chip8, instructions_before_tick(chip8, budget - skipped));
+                if (count == 0)
+                        break;
+                advance_cycles(chip8, count);
+                skipped += count;
+        }
+        return skipped;
+}
+
+// Verdadeiro se a instrução atual não sai do lugar sem interação externa:
+// `1NNN` para o próprio endereço, `00FD` ou `Fx0A` bloqueado
+bool program_stuck(const Chip8 *chip8) {
+        const uint16_t pc = chip8->program_counter;
+        if (pc >= MEMORY_SIZE - 1)
+                return false;
+        if (op_code_at(chip8, pc) == 0x00FD)
+                return true;
+
+        const uint8_t first_byte = chip8->memory[pc];
+        const uint8_t second_byte = chip8->memory[pc + 1];
+        const uint16_t address = ((uint16_t)(first_byte & 0x0F) << 8) |
+                                 second_byte;
+
+        if ((first_byte >> 4) == 0x1 && address == pc)
+                return true;
+
+        return waiting_for_key(chip8);
+}
+
+bool waiting_for_key(const Chip8 *chip8) {
+        if ((op_code_at(chip8, chip8->program_counter) & 0xF0FF) != 0xF00A)
+                return false;
+        if (chip8->key_wait != 0)
+                return key_pressed(chip8, chip8->key_wait - 1);
+        return chip8->keypad == 0;
+}
+
+// A resolução entra no hash: o mesmo conteúdo aparece diferente em cada uma
+uint64_t display_hash(const Chip8 *chip8) {
+        const uint8_t *bytes = (const uint8_t *)chip8->display;
+        uint64_t hash = 0xCBF29CE484222325;
+        hash ^= chip8->hires;
+        hash *= 0x100000001B3;
+        for (size_t i = 0; i < sizeof(chip8->display); ++i) {
+                hash ^= bytes[i];
+                hash *= 0x100000001B3;
+        }
+        return hash;
 }
 
 void __init_fonts(Chip8 *chip8) {
@@ -677,4 +1133,30 @@ void __init_fonts(Chip8 *chip8) {
         for (size_t i = 0; i < FONTSET_COUNT * FONT_SPRITE_SIZE; ++i) {
                 chip8->memory[FONTSET_START + i] = fontset[i];
         }
+
+        // Dígitos 8x10 do SUPER-CHIP, com A-F como no XO-CHIP
+        static const uint8_t big_fontset[] = {
+            0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C, // 0
+            0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C, // 1
+            0x3E, 0x7F, 0xC3, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xFF, 0xFF, // 2
+            0x3C, 0x7E, 0xC3, 0x03, 0x0E, 0x0E, 0x03, 0xC3, 0x7E, 0x3C, // 3
+            0x06, 0x0E, 0x1E, 0x36, 0x66, 0xC6, 0xFF, 0xFF, 0x06, 0x06, // 4
+            0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFE, 0x03, 0xC3, 0x7E, 0x3C, // 5
+            0x3E, 0x7C, 0xE0, 0xC0, 0xFC, 0xFE, 0xC3, 0xC3, 0x7E, 0x3C, // 6
+            0xFF, 0xFF, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x60, 0x60, // 7
+            0x3C, 0x7E, 0xC3, 0xC3, 0x7E, 0x7E, 0xC3, 0xC3, 0x7E, 0x3C, // 8
+            0x3C, 0x7E, 0xC3, 0xC3, 0x7F, 0x3F, 0x03, 0x03, 0x3E, 0x7C, // 9
+            0x18, 0x3C, 0x66, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+            0xFC, 0xFE, 0xC3, 0xC3, 0xFE, 0xFE, 0xC3, 0xC3, 0xFE, 0xFC, // B
+            0x3C, 0x7E, 0xE3, 0xC0, 0xC0, 0xC0, 0xC0, 0xE3, 0x7E, 0x3C, // C
+            0xFC, 0xFE, 0xC7, 0xC3, 0xC3, 0xC3, 0xC3, 0xC7, 0xFE, 0xFC, // D
+            0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFC, 0xC0, 0xC0, 0xFF, 0xFF, // E
+            0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFC, 0xC0, 0xC0, 0xC0, 0xC0, // F
+        };
+
+        static_assert(BIG_FONTSET_START + sizeof(big_fontset) <= PROGRAM_START,
+                      "A fonte grande não cabe antes do programa");
+
+        memcpy(&chip8->memory[BIG_FONTSET_START], big_fontset,
+               sizeof(big_fontset));
 }
@@ -1,3 +1,4 @@
+#include "trace.h"
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -5,10 +6,18 @@
 #ifndef SYSTEM_H
 #define SYSTEM_H
 
-#define DISPLAY_WIDTH 64
-#define DISPLAY_HEIGHT 32
+// Tela de alta resolução do SUPER-CHIP. A baixa resolução usa o canto
+// superior esquerdo dela, com metade da largura e da altura.
+#define DISPLAY_WIDTH 128
+#define DISPLAY_HEIGHT 64
+#define LORES_WIDTH 64
+#define LORES_HEIGHT 32
+// Palavras de 64 bits por linha da tela
+#define DISPLAY_WORDS (DISPLAY_WIDTH / 64)
 #define REGISTER_COUNT 16
-#define MEMORY_SIZE 0xFFF
+#define MEMORY_SIZE 0x1000
+// Endereços dão a volta no fim da memória: `address & ADDRESS_MASK`
+#define ADDRESS_MASK (MEMORY_SIZE - 1)
 #define STACK_DEPTH 16
 #define KEY_COUNT 16
 
@@ -20,25 +29,151 @@
 #define FONTSET_COUNT 16
 // Quantidade de bytes para cada caractere
 #define FONT_SPRITE_SIZE 5
+// Fonte grande do SUPER-CHIP (Fx30), 8x10, logo depois da pequena
+#define BIG_FONTSET_START (FONTSET_START + FONTSET_COUNT * FONT_SPRITE_SIZE)
+#define BIG_FONT_SPRITE_SIZE 10
+// Flags RPL do SUPER-CHIP (Fx75/Fx85); o XO-CHIP usa as 16
+#define RPL_FLAG_COUNT 16
 
 typedef uint8_t Instruction[2];
 
+// Falhas que param a instância, sem afetar o resto do processo
+typedef enum {
+        FAULT_NONE,
+        FAULT_STACK_OVERFLOW,
+        FAULT_STACK_UNDERFLOW,
+        FAULT_INVALID_INSTRUCTION,
+        // Buscar uma instrução que não cabe no fim da memória. Os acessos
+        // pelo I dão a volta e nunca falham.
+        FAULT_INVALID_ADDRESS,
+} Fault;
+
+// Perfis de compatibilidade, cada um um conjunto fixo de quirks
+typedef enum {
+        // COSMAC VIP, o CHIP-8 original
+        QUIRKS_CHIP8,
+        // SUPER-CHIP 1.1
+        QUIRKS_SCHIP,
+        QUIRKS_XOCHIP,
+        QUIRK_PROFILE_COUNT,
+} QuirkProfile;
+
+// 8xy1, 8xy2 e 8xy3 zeram o VF
+#define QUIRK_VF_RESET (1u << 0)
+// Fx55 e Fx65 deixam o I depois do último registrador
+#define QUIRK_MEMORY_INCREMENT (1u << 1)
+// 8xy6 e 8xyE deslocam o próprio VX, ignorando o VY
+#define QUIRK_SHIFT_VX (1u << 2)
+// BXNN salta para XNN + VX, no lugar de NNN + V0
+#define QUIRK_JUMP_VX (1u << 3)
+// Sprites são cortados na borda da tela, no lugar de dar a volta
+#define QUIRK_CLIP (1u << 4)
+
+#define QUIRKS_CHIP8_FLAGS                                                     \
+        (QUIRK_VF_RESET | QUIRK_MEMORY_INCREMENT | QUIRK_CLIP)
+#define QUIRKS_SCHIP_FLAGS (QUIRK_SHIFT_VX | QUIRK_JUMP_VX | QUIRK_CLIP)
+#define QUIRKS_XOCHIP_FLAGS (QUIRK_MEMORY_INCREMENT)
+
+// Registro da falha. A instrução que falhou não tem efeito nenhum: o PC
+// continua nela e o relógio não avança.
 typedef struct {
+        Fault fault;
+        uint16_t program_counter;
+        uint16_t op_code;
+} Trap;
+
+// Motivo pelo qual `run()` retornou
+typedef enum {
+        // Executou todas as instruções pedidas
+        RUN_BUDGET,
+        // Dxyn, 00E0, rolagem ou troca de resolução mudou a tela
+        RUN_DISPLAY,
+        // Fx0A sem tecla pressionada: o PC continua na instrução
+        RUN_WAITING_KEY,
+        // Fx18 ligou o som
+        RUN_SOUND,
+        // O PC chegou num breakpoint, que ainda não foi executado
+        RUN_BREAKPOINT,
+        // A instância falhou (`chip8->trap`)
+        RUN_FAULT,
+} RunReason;
+
+// Um bit por endereço da memória
+typedef struct {
+        uint64_t bits[(MEMORY_SIZE + 63) / 64];
+} Breakpoints;
+
+// Valor de `breakpoint_pc` quando o `run()` não parou num breakpoint
+#define NO_BREAKPOINT_PC 0xFFFF
+
+// Os campos usados por quase toda instrução ficam juntos na primeira linha
+// de cache; a memória começa alinhada numa linha própria, e a tela e o
+// resto vêm depois. Alocações dinâmicas precisam de `aligned_alloc()`.
+typedef struct {
+        // Linha de cache quente: 64 bytes
         uint16_t program_counter;
         uint16_t index_register;
         uint8_t registers[REGISTER_COUNT];
-        uint8_t memory[MEMORY_SIZE];
-        uint16_t stack[STACK_DEPTH];
         uint8_t stack_pointer;
         uint8_t delay_timer;
         uint8_t sound_timer;
-        bool keypad[KEY_COUNT];
-        bool display[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+        // Fx0A espera a tecla ser solta: guarda a tecla pressionada durante
+        // a espera, mais um (0 = nenhuma ainda)
+        uint8_t key_wait;
+        // Bit N ligado enquanto a tecla N está pressionada
+        uint16_t keypad;
         bool redraw;
-        uint8_t op_code;
+        // Perfil de quirks (`QuirkProfile`). É configuração, como a
+        // semente: o `reset()` mantém.
+        uint8_t quirks;
+        // Alta resolução do SUPER-CHIP (00FF), 128x64
+        bool hires;
+        // Modelo de tempo dirigido por instruções: os timers de 60Hz avançam
+        // a cada `instructions_per_tick` instruções executadas, de forma
+        // reprodutível. Com 0, quem hospeda o Chip8 chama `tick_timers()`.
+        uint32_t instructions_per_tick;
+        uint32_t instructions_until_tick;
+        uint64_t cycle_count;
+        // Gerador do CxNN (PCG32), um por instância. A semente é
+        // configuração, como `instructions_per_tick`: o `reset()` volta o
+        // estado para o início da sequência dela.
+        uint64_t random_state;
+        // Quando não nulo, `step()` grava um registro por instrução
+        TraceBuffer *trace;
+
+        // Quando não nulo, `run()` para antes dos endereços marcados
+        const Breakpoints *breakpoints;
+        // Depois de uma falha, nenhuma instrução é executada até o `reset()`
+        Trap trap;
+        // PC do breakpoint onde o `run()` parou, executado sem parar na
+        // próxima instrução; `NO_BREAKPOINT_PC` quando não parou
+        uint16_t breakpoint_pc;
+        uint64_t random_seed;
+        uint16_t stack[STACK_DEPTH];
+        // Chamado quando uma instrução escreve na memória (Fx33/Fx55),
+        // permitindo invalidar instruções pré-decodificadas
+        void (*on_memory_write)(void *context, uint16_t address,
+                                uint16_t length);
+        void *memory_write_context;
+        // Guardadas pelo Fx75 e lidas pelo Fx85. Como na calculadora HP48,
+        // sobrevivem ao `reset()`; só o `init()` zera.
+        uint8_t rpl_flags[RPL_FLAG_COUNT];
+
+        _Alignas(64) uint8_t memory[MEMORY_SIZE];
+        // Linhas de `DISPLAY_WORDS` palavras; o bit mais significativo da
+        // primeira palavra é a coluna 0. Em baixa resolução só a primeira
+        // palavra das primeiras `LORES_HEIGHT` linhas é usada.
+        uint64_t display[DISPLAY_HEIGHT][DISPLAY_WORDS];
 } Chip8;
 
 void clear_display(Chip8 *chip8);
+// Rolagens do SUPER-CHIP, em pixels da resolução atual: linhas inteiras
+// movidas de uma vez, sem passar pixel a pixel
+void scroll_down(Chip8 *chip8, uint8_t n);
+void scroll_right(Chip8 *chip8);
+void scroll_left(Chip8 *chip8);
+// 00FE/00FF: troca a resolução e limpa a tela
+void set_hires(Chip8 *chip8, bool hires);
 void return_from_subroutine(Chip8 *chip8);
 void jump_to_address(Chip8 *chip8, uint16_t address);
 void call_subroutine(Chip8 *chip8, uint16_t address);
@@ -53,29 +188,138 @@ void set_and(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y);
 void set_xor(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y);
 void set_add(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y);
 void set_sub(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y);
-void set_rshift(Chip8 *chip8, uint8_t reg_x);
+// VX = VY deslocado, VF = bit que saiu; com QUIRK_SHIFT_VX, `reg_y` é o VX
+void set_rshift(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y);
 void set_subn(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y);
-void set_lshift(Chip8 *chip8, uint8_t reg_x);
+void set_lshift(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y);
 void skip_if_not_equal_registers(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y);
 void set_index_register(Chip8 *chip8, uint16_t address);
-void jump_with_offset(Chip8 *chip8, uint16_t address);
+// Salta para `address` + V[`reg`]: V0, ou VX com QUIRK_JUMP_VX
+void jump_with_offset(Chip8 *chip8, uint16_t address, uint8_t reg);
 void set_random_and(Chip8 *chip8, uint8_t reg, uint8_t value);
+// O sprite dá a volta na borda da tela. Com `n` 0, desenha um sprite de
+// 16x16, com 2 bytes por linha (SUPER-CHIP).
 void draw_sprite(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y, uint8_t n);
-void skip_if_pressed(Chip8 *chip8, uint8_t key);
-void skip_if_not_pressed(Chip8 *chip8, uint8_t key);
+// O sprite é cortado na borda da tela (QUIRK_CLIP)
+void draw_sprite_clipped(Chip8 *chip8, uint8_t reg_x, uint8_t reg_y,
+                         uint8_t n);
+void skip_if_pressed(Chip8 *chip8, uint8_t reg);
+void skip_if_not_pressed(Chip8 *chip8, uint8_t reg);
 void load_delay_timer_to_register(Chip8 *chip8, uint8_t reg);
 bool load_key_to_register(Chip8 *chip8, uint8_t reg);
 void set_delay_timer(Chip8 *chip8, uint8_t reg);
 void set_sound_timer(Chip8 *chip8, uint8_t reg);
 void offset_index_register(Chip8 *chip8, uint8_t reg);
 void load_sprite_font(Chip8 *chip8, uint8_t reg);
+void load_big_sprite_font(Chip8 *chip8, uint8_t reg);
 void store_bcd(Chip8 *chip8, uint8_t reg);
 void store_registers(Chip8 *chip8, uint8_t reg_stop);
 void load_to_registers(Chip8 *chip8, uint8_t reg_stop);
+void store_rpl_flags(Chip8 *chip8, uint8_t reg_stop);
+void load_rpl_flags(Chip8 *chip8, uint8_t reg_stop);
+
+// Parte dos quirks que vem depois da instrução, nos perfis que a têm
+static inline void reset_flag(Chip8 *chip8) { chip8->registers[0xF] = 0; }
+
+static inline void increment_index(Chip8 *chip8, uint8_t reg_stop) {
+        chip8->index_register += reg_stop + 1;
+}
+
+static inline uint8_t quirk_flags(QuirkProfile profile) {
+        switch (profile) {
+        case QUIRKS_SCHIP:
+                return QUIRKS_SCHIP_FLAGS;
+        case QUIRKS_XOCHIP:
+                return QUIRKS_XOCHIP_FLAGS;
+        default:
+                return QUIRKS_CHIP8_FLAGS;
+        }
+}
+
+static inline bool key_pressed(const Chip8 *chip8, uint8_t key) {
+        return (chip8->keypad >> (key & 0xF)) & 1;
+}
+
+// Tamanho da tela na resolução atual
+static inline uint8_t display_width(const Chip8 *chip8) {
+        return chip8->hires ? DISPLAY_WIDTH : LORES_WIDTH;
+}
+
+static inline uint8_t display_height(const Chip8 *chip8) {
+        return chip8->hires ? DISPLAY_HEIGHT : LORES_HEIGHT;
+}
+
+static inline bool display_pixel(const Chip8 *chip8, uint8_t x, uint8_t y) {
+        return (chip8->display[y][x / 64] >> (63 - x % 64)) & 0x1;
+}
+
+// Quantas das `budget` instruções podem rodar antes do próximo tick dos
+// timers, para núcleos que executam várias instruções de uma vez
+static inline uint32_t instructions_before_tick(const Chip8 *chip8,
+                                                uint32_t budget) {
+        if (chip8->instructions_per_tick > 0 &&
+            chip8->instructions_until_tick < budget)
+                return chip8->instructions_until_tick;
+        return budget;
+}
+
+static inline void set_breakpoint(Breakpoints *breakpoints,
+                                  uint16_t address, bool enabled) {
+        const uint64_t bit = UINT64_C(1) << (address % 64);
+        if (enabled)
+                breakpoints->bits[address / 64] |= bit;
+        else
+                breakpoints->bits[address / 64] &= ~bit;
+}
+
+static inline bool has_breakpoint(const Breakpoints *breakpoints,
+                                  uint16_t address) {
+        return address < MEMORY_SIZE &&
+               ((breakpoints->bits[address / 64] >> (address % 64)) & 1);
+}
 
 void init(Chip8 *chip8, uint8_t *program, size_t program_size);
 void reset(Chip8 *chip8);
-void step(Chip8 *chip8);
-void reset_keys(Chip8 *chip8);
+// Executa uma instrução e avança o relógio. Retorna a falha que parou a
+// instância, ou FAULT_NONE.
+Fault step(Chip8 *chip8);
+// Executa até `max_cycles` instruções, como `step()` em laço, retornando
+// antes no primeiro evento. As instruções executadas aparecem em
+// `cycle_count`. Depois de parar num breakpoint, a chamada seguinte continua
+// dele.
+RunReason run(Chip8 *chip8, uint32_t max_cycles);
+// Executa uma instrução sem avançar o relógio. Cada perfil tem sua cópia
+// do interpretador, com os quirks resolvidos na compilação; aqui só se
+// escolhe a cópia.
+void execute(Chip8 *chip8);
+const char *fault_name(Fault fault);
+const char *quirk_profile_name(QuirkProfile profile);
+bool parse_quirk_profile(const char *name, QuirkProfile *profile);
+// Troca o perfil, descartando instruções pré-decodificadas com o anterior
+void set_quirk_profile(Chip8 *chip8, QuirkProfile profile);
+void tick_timers(Chip8 *chip8);
+void set_instructions_per_tick(Chip8 *chip8, uint32_t instructions_per_tick);
+void set_random_seed(Chip8 *chip8, uint64_t seed);
+// Conta instruções executadas, avançando os timers a cada tick
+void advance_cycles(Chip8 *chip8, uint32_t count);
+// Instruções por volta do laço de espera que começa no PC (salto para o
+// próprio endereço, Fx0A bloqueado, 00FD ou espera pelo DT), ou 0 se não há
+// um
+uint8_t idle_loop_length(const Chip8 *chip8);
+// Avança voltas inteiras do laço de espera do PC, até `budget` instruções,
+// sem avançar o relógio; `budget` não pode passar do próximo tick. Retorna
+// quantas instruções foram puladas. Desligado com trace ou breakpoints.
+uint32_t skip_idle_loop(Chip8 *chip8, uint32_t budget);
+// Como `skip_idle_loop()`, mas atravessando ticks e avançando o relógio:
+// continua enquanto o laço não termina, até `budget` instruções
+uint32_t run_idle_loop(Chip8 *chip8, uint32_t budget);
+// Verdadeiro se o programa está parado num laço que só termina com
+// interação externa, ou saiu pelo 00FD
+bool program_stuck(const Chip8 *chip8);
+// Verdadeiro se o PC está num Fx0A que não termina sem uma mudança no
+// teclado: nenhuma tecla pressionada, ou a tecla da espera ainda pressionada
+bool waiting_for_key(const Chip8 *chip8);
+// Hash FNV-1a do conteúdo da tela, para comparar execuções
+uint64_t display_hash(const Chip8 *chip8);
 
 #endif
\ No newline at end of file
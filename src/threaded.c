@@ -0,0 +1,356 @@
+#include "threaded.h"
+#include "system.h"
+#include <stdint.h>
+
+#if USE_COMPUTED_GOTO
+
+// Cada handler termina saltando direto para o handler da próxima instrução,
+// sem voltar para um laço central de despacho
+#define DISPATCH()                                                             \
+        do {                                                                   \
+                if (executed == max_instructions)                              \
+                        goto done;                                             \
+                executed++;                                                    \
+                if (chip8->program_counter >= MEMORY_SIZE - 1)                 \
+                        goto op_fallback;                                      \
+                first_byte = chip8->memory[chip8->program_counter];            \
+                second_byte = chip8->memory[chip8->program_counter + 1];       \
+                v_x = first_byte & 0x0F;                                       \
+                v_y = second_byte >> 4;                                        \
+                last_nibble = second_byte & 0x0F;                              \
+                address = ((uint16_t)(v_x) << 8) | second_byte;                \
+                goto *primary[first_byte >> 4];                                \
+        } while (0)
+
+#define NEXT()                                                                 \
+        do {                                                                   \
+                chip8->program_counter += 2;                                   \
+                DISPATCH();                                                    \
+        } while (0)
+
+// Depois de instruções que podem falhar: a instrução que falhou não conta
+// como executada
+#define CHECK_TRAP()                                                           \
+        do {                                                                   \
+                if (chip8->trap.fault != FAULT_NONE) {                         \
+                        executed--;                                            \
+                        goto done;                                             \
+                }                                                              \
+        } while (0)
+
+// Handler escolhido pelo quirk, na montagem da tabela de um perfil
+#define QUIRK(flags, quirk, with, without)                                     \
+        ((flags) & (quirk) ? (with) : (without))
+
+#define PRIMARY_TABLE(flags)                                                   \
+        {                                                                      \
+            &&op_0xxx, &&op_1nnn, &&op_2nnn, &&op_3xnn, &&op_4xnn, &&op_5xy0,  \
+            &&op_6xnn, &&op_7xnn, &&op_8xyn, &&op_9xy0, &&op_annn,             \
+            QUIRK(flags, QUIRK_JUMP_VX, &&op_bnnn_vx, &&op_bnnn), &&op_cxnn,   \
+            QUIRK(flags, QUIRK_CLIP, &&op_dxyn_clipped, &&op_dxyn), &&op_exnn, \
+            &&op_fxnn,                                                         \
+        }
+
+// As tabelas secundárias preenchem tudo com o fallback e depois sobrescrevem
+// as instruções conhecidas
+#define TABLE_8(flags)                                                         \
+        {                                                                      \
+            [0 ... 15] = &&op_fallback,                                        \
+            [0x0] = &&op_8xy0,                                                 \
+            [0x1] = QUIRK(flags, QUIRK_VF_RESET, &&op_8xy1_reset, &&op_8xy1),  \
+            [0x2] = QUIRK(flags, QUIRK_VF_RESET, &&op_8xy2_reset, &&op_8xy2),  \
+            [0x3] = QUIRK(flags, QUIRK_VF_RESET, &&op_8xy3_reset, &&op_8xy3),  \
+            [0x4] = &&op_8xy4,                                                 \
+            [0x5] = &&op_8xy5,                                                 \
+            [0x6] = QUIRK(flags, QUIRK_SHIFT_VX, &&op_8xy6_vx, &&op_8xy6),     \
+            [0x7] = &&op_8xy7,                                                 \
+            [0xE] = QUIRK(flags, QUIRK_SHIFT_VX, &&op_8xye_vx, &&op_8xye),     \
+        }
+
+#define TABLE_F(flags)                                                         \
+        {                                                                      \
+            [0 ... 255] = &&op_fallback,                                       \
+            [0x07] = &&op_fx07,                                                \
+            [0x0A] = &&op_fx0a,                                                \
+            [0x15] = &&op_fx15,                                                \
+            [0x18] = &&op_fx18,                                                \
+            [0x1E] = &&op_fx1e,                                                \
+            [0x29] = &&op_fx29,                                                \
+            [0x30] = &&op_fx30,                                                \
+            [0x33] = &&op_fx33,                                                \
+            [0x55] = QUIRK(flags, QUIRK_MEMORY_INCREMENT, &&op_fx55_increment, \
+                           &&op_fx55),                                         \
+            [0x65] = QUIRK(flags, QUIRK_MEMORY_INCREMENT, &&op_fx65_increment, \
+                           &&op_fx65),                                         \
+            [0x75] = &&op_fx75,                                                \
+            [0x85] = &&op_fx85,                                                \
+        }
+
+// Executa até `max_instructions` sem avançar o relógio; o chamador garante
+// que nenhum tick dos timers cai no meio do trecho
+static uint32_t run_chunk(Chip8 *chip8, uint32_t max_instructions) {
+        // Uma tabela por perfil, com os handlers dos seus quirks: a escolha
+        // do perfil acontece uma vez por trecho, e nenhum handler testa
+        // quirks
+        static void *const primary_table[QUIRK_PROFILE_COUNT][16] = {
+            [QUIRKS_CHIP8] = PRIMARY_TABLE(QUIRKS_CHIP8_FLAGS),
+            [QUIRKS_SCHIP] = PRIMARY_TABLE(QUIRKS_SCHIP_FLAGS),
+            [QUIRKS_XOCHIP] = PRIMARY_TABLE(QUIRKS_XOCHIP_FLAGS),
+        };
+        // As entradas específicas sobrescrevem o padrão de propósito
+#pragma GCC diagnostic push
+#if defined(__clang__)
+#pragma clang diagnostic ignored "-Winitializer-overrides"
+#else
+#pragma GCC diagnostic ignored "-Woverride-init"
+#endif
+        static void *const table_0[256] = {
+            [0 ... 255] = &&op_fallback,
+            [0xC0 ... 0xCF] = &&op_00cn,
+            [0xE0] = &&op_00e0,
+            [0xEE] = &&op_00ee,
+            [0xFB] = &&op_00fb,
+            [0xFC] = &&op_00fc,
+            [0xFE] = &&op_00fe,
+            [0xFF] = &&op_00ff,
+        };
+        static void *const table_8[QUIRK_PROFILE_COUNT][16] = {
+            [QUIRKS_CHIP8] = TABLE_8(QUIRKS_CHIP8_FLAGS),
+            [QUIRKS_SCHIP] = TABLE_8(QUIRKS_SCHIP_FLAGS),
+            [QUIRKS_XOCHIP] = TABLE_8(QUIRKS_XOCHIP_FLAGS),
+        };
+        static void *const table_e[256] = {
+            [0 ... 255] = &&op_fallback,
+            [0x9E] = &&op_ex9e,
+            [0xA1] = &&op_exa1,
+        };
+        static void *const table_f[QUIRK_PROFILE_COUNT][256] = {
+            [QUIRKS_CHIP8] = TABLE_F(QUIRKS_CHIP8_FLAGS),
+            [QUIRKS_SCHIP] = TABLE_F(QUIRKS_SCHIP_FLAGS),
+            [QUIRKS_XOCHIP] = TABLE_F(QUIRKS_XOCHIP_FLAGS),
+        };
+#pragma GCC diagnostic pop
+
+        const uint8_t profile =
+            chip8->quirks < QUIRK_PROFILE_COUNT ? chip8->quirks : QUIRKS_CHIP8;
+        void *const *const primary = primary_table[profile];
+        void *const *const table_8_profile = table_8[profile];
+        void *const *const table_f_profile = table_f[profile];
+
+        uint32_t executed = 0;
+        uint8_t first_byte;
+        uint8_t second_byte;
+        uint8_t v_x;
+        uint8_t v_y;
+        uint8_t last_nibble;
+        uint16_t address;
+
+        DISPATCH();
+
+op_0xxx:
+        goto *table_0[second_byte];
+op_00cn:
+        scroll_down(chip8, last_nibble);
+        NEXT();
+op_00e0:
+        clear_display(chip8);
+        NEXT();
+op_00ee:
+        return_from_subroutine(chip8);
+        CHECK_TRAP();
+        DISPATCH();
+op_00fb:
+        scroll_right(chip8);
+        NEXT();
+op_00fc:
+        scroll_left(chip8);
+        NEXT();
+op_00fe:
+        set_hires(chip8, false);
+        NEXT();
+op_00ff:
+        set_hires(chip8, true);
+        NEXT();
+op_1nnn:
+        jump_to_address(chip8, address);
+        executed += skip_idle_loop(chip8, max_instructions - executed);
+        DISPATCH();
+op_2nnn:
+        call_subroutine(chip8, address);
+        CHECK_TRAP();
+        DISPATCH();
+op_3xnn:
+        skip_if_equal(chip8, v_x, second_byte);
+        NEXT();
+op_4xnn:
+        skip_if_not_equal(chip8, v_x, second_byte);
+        NEXT();
+op_5xy0:
+        skip_if_equal_registers(chip8, v_x, v_y);
+        NEXT();
+op_6xnn:
+        set_register(chip8, v_x, second_byte);
+        NEXT();
+op_7xnn:
+        add_to_register(chip8, v_x, second_byte);
+        NEXT();
+op_8xyn:
+        goto *table_8_profile[last_nibble];
+op_8xy0:
+        copy_register(chip8, v_x, v_y);
+        NEXT();
+op_8xy1:
+        set_or(chip8, v_x, v_y);
+        NEXT();
+op_8xy1_reset:
+        set_or(chip8, v_x, v_y);
+        reset_flag(chip8);
+        NEXT();
+op_8xy2:
+        set_and(chip8, v_x, v_y);
+        NEXT();
+op_8xy2_reset:
+        set_and(chip8, v_x, v_y);
+        reset_flag(chip8);
+        NEXT();
+op_8xy3:
+        set_xor(chip8, v_x, v_y);
+        NEXT();
+op_8xy3_reset:
+        set_xor(chip8, v_x, v_y);
+        reset_flag(chip8);
+        NEXT();
+op_8xy4:
+        set_add(chip8, v_x, v_y);
+        NEXT();
+op_8xy5:
+        set_sub(chip8, v_x, v_y);
+        NEXT();
+op_8xy6:
+        set_rshift(chip8, v_x, v_y);
+        NEXT();
+op_8xy6_vx:
+        set_rshift(chip8, v_x, v_x);
+        NEXT();
+op_8xy7:
+        set_subn(chip8, v_x, v_y);
+        NEXT();
+op_8xye:
+        set_lshift(chip8, v_x, v_y);
+        NEXT();
+op_8xye_vx:
+        set_lshift(chip8, v_x, v_x);
+        NEXT();
+op_9xy0:
+        skip_if_not_equal_registers(chip8, v_x, v_y);
+        NEXT();
+op_annn:
+        set_index_register(chip8, address);
+        NEXT();
+op_bnnn:
+        jump_with_offset(chip8, address, 0);
+        DISPATCH();
+op_bnnn_vx:
+        jump_with_offset(chip8, address, v_x);
+        DISPATCH();
+op_cxnn:
+        set_random_and(chip8, v_x, second_byte);
+        NEXT();
+op_dxyn:
+        draw_sprite(chip8, v_x, v_y, last_nibble);
+        NEXT();
+op_dxyn_clipped:
+        draw_sprite_clipped(chip8, v_x, v_y, last_nibble);
+        NEXT();
+op_exnn:
+        goto *table_e[second_byte];
+op_ex9e:
+        skip_if_pressed(chip8, v_x);
+        NEXT();
+op_exa1:
+        skip_if_not_pressed(chip8, v_x);
+        NEXT();
+op_fxnn:
+        goto *table_f_profile[second_byte];
+op_fx07:
+        load_delay_timer_to_register(chip8, v_x);
+        NEXT();
+op_fx0a:
+        if (load_key_to_register(chip8, v_x))
+                chip8->program_counter += 2;
+        else
+                executed += skip_idle_loop(chip8, max_instructions - executed);
+        DISPATCH();
+op_fx15:
+        set_delay_timer(chip8, v_x);
+        NEXT();
+op_fx18:
+        set_sound_timer(chip8, v_x);
+        NEXT();
+op_fx1e:
+        offset_index_register(chip8, v_x);
+        NEXT();
+op_fx29:
+        load_sprite_font(chip8, v_x);
+        NEXT();
+op_fx30:
+        load_big_sprite_font(chip8, v_x);
+        NEXT();
+op_fx33:
+        store_bcd(chip8, v_x);
+        NEXT();
+op_fx55:
+        store_registers(chip8, v_x);
+        NEXT();
+op_fx55_increment:
+        store_registers(chip8, v_x);
+        increment_index(chip8, v_x);
+        NEXT();
+op_fx65:
+        load_to_registers(chip8, v_x);
+        NEXT();
+op_fx65_increment:
+        load_to_registers(chip8, v_x);
+        increment_index(chip8, v_x);
+        NEXT();
+op_fx75:
+        store_rpl_flags(chip8, v_x);
+        NEXT();
+op_fx85:
+        load_rpl_flags(chip8, v_x);
+        NEXT();
+op_fallback:
+        // Instruções sem handler próprio seguem o caminho do `execute()`
+        execute(chip8);
+        CHECK_TRAP();
+        DISPATCH();
+
+done:
+        return executed;
+}
+
+uint32_t run_threaded(Chip8 *chip8, uint32_t max_instructions) {
+        uint32_t executed = 0;
+        while (executed < max_instructions &&
+               chip8->trap.fault == FAULT_NONE) {
+                const uint32_t chunk =
+                    instructions_before_tick(chip8, max_instructions - executed);
+                const uint32_t ran = run_chunk(chip8, chunk);
+                advance_cycles(chip8, ran);
+                executed += ran;
+        }
+        return executed;
+}
+
+#else
+
+// Sem computed goto, o núcleo recai no `step()` executado em laço
+uint32_t run_threaded(Chip8 *chip8, uint32_t max_instructions) {
+        for (uint32_t i = 0; i < max_instructions; ++i) {
+                if (step(chip8) != FAULT_NONE)
+                        return i;
+        }
+        return max_instructions;
+}
+
+#endif
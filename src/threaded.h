@@ -0,0 +1,19 @@
+#include "system.h"
+#include <stdint.h>
+
+#ifndef THREADED_H
+#define THREADED_H
+
+// Usa computed goto quando o compilador suporta (GCC/Clang), a menos que
+// o build desabilite com -DNO_COMPUTED_GOTO
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(NO_COMPUTED_GOTO)
+#define USE_COMPUTED_GOTO 1
+#else
+#define USE_COMPUTED_GOTO 0
+#endif
+
+// Executa até `max_instructions` instruções e retorna quantas foram
+// executadas. Para antes se a instância falhar (`chip8->trap`).
+uint32_t run_threaded(Chip8 *chip8, uint32_t max_instructions);
+
+#endif
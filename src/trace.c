@@ -0,0 +1,136 @@
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TRACE_FILE_SUPPORTED 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define TRACE_FILE_SUPPORTED 0
+#endif
+
+static uint32_t round_up_power_of_two(uint32_t value) {
+        uint32_t result = 1;
+        while (result < value && result < (1u << 31)) {
+                result <<= 1;
+        }
+        return result;
+}
+
+static void attach_region(TraceBuffer *trace, void *region, size_t size,
+                          bool mapped) {
+        trace->region = region;
+        trace->region_size = size;
+        trace->mapped = mapped;
+        trace->header = region;
+        trace->records =
+            (TraceRecord *)((uint8_t *)region + sizeof(TraceHeader));
+        trace->mask = trace->header->capacity - 1;
+}
+
+bool trace_open(TraceBuffer *trace, uint32_t capacity, const char *path) {
+        capacity = round_up_power_of_two(capacity);
+        const size_t size =
+            sizeof(TraceHeader) + (size_t)capacity * sizeof(TraceRecord);
+
+        void *region = NULL;
+        bool mapped = false;
+        if (path == NULL) {
+                region = calloc(1, size);
+                if (region == NULL)
+                        return false;
+        } else {
+#if TRACE_FILE_SUPPORTED
+                const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+                if (fd < 0)
+                        return false;
+                if (ftruncate(fd, (off_t)size) != 0) {
+                        close(fd);
+                        return false;
+                }
+                region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                              fd, 0);
+                // O mapeamento continua válido depois de fechar o arquivo
+                close(fd);
+                if (region == MAP_FAILED)
+                        return false;
+                mapped = true;
+#else
+                return false;
+#endif
+        }
+
+        TraceHeader *header = region;
+        memcpy(header->magic, TRACE_MAGIC, sizeof(header->magic));
+        header->version = TRACE_VERSION;
+        header->record_size = sizeof(TraceRecord);
+        header->capacity = capacity;
+        header->count = 0;
+        attach_region(trace, region, size, mapped);
+        return true;
+}
+
+bool trace_load(TraceBuffer *trace, const char *path) {
+#if TRACE_FILE_SUPPORTED
+        const int fd = open(path, O_RDONLY);
+        if (fd < 0)
+                return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 ||
+            (size_t)info.st_size < sizeof(TraceHeader)) {
+                close(fd);
+                return false;
+        }
+        const size_t size = (size_t)info.st_size;
+        void *region = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (region == MAP_FAILED)
+                return false;
+
+        const TraceHeader *header = region;
+        const bool valid =
+            memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) == 0 &&
+            header->version == TRACE_VERSION &&
+            header->record_size == sizeof(TraceRecord) &&
+            header->capacity > 0 &&
+            (header->capacity & (header->capacity - 1)) == 0 &&
+            size == sizeof(TraceHeader) +
+                        (size_t)header->capacity * sizeof(TraceRecord);
+        if (!valid) {
+                munmap(region, size);
+                return false;
+        }
+        attach_region(trace, region, size, true);
+        return true;
+#else
+        (void)trace;
+        (void)path;
+        return false;
+#endif
+}
+
+void trace_close(TraceBuffer *trace) {
+        if (trace->region == NULL)
+                return;
+#if TRACE_FILE_SUPPORTED
+        if (trace->mapped) {
+                munmap(trace->region, trace->region_size);
+        } else {
+                free(trace->region);
+        }
+#else
+        free(trace->region);
+#endif
+        trace->region = NULL;
+        trace->header = NULL;
+        trace->records = NULL;
+}
+
+uint64_t trace_first(const TraceBuffer *trace) {
+        const uint64_t count = trace->header->count;
+        const uint64_t capacity = trace->header->capacity;
+        return count > capacity ? count - capacity : 0;
+}
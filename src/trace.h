@@ -0,0 +1,73 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#define TRACE_MAGIC "C8TR"
+#define TRACE_VERSION 1
+// Capacidade padrão do buffer circular, em registros
+#define TRACE_DEFAULT_CAPACITY (1u << 20)
+// Valor de `changed_register` quando nenhum registrador mudou
+#define TRACE_NO_REGISTER 0xFF
+
+// Um registro por instrução executada, com o estado logo depois dela
+typedef struct {
+        uint16_t program_counter;
+        uint16_t op_code;
+        uint16_t index_register;
+        // Primeiro registrador alterado (VF só se for o único) e seu valor
+        uint8_t changed_register;
+        uint8_t changed_value;
+        uint8_t flag;
+        uint8_t reserved;
+} TraceRecord;
+
+// Cabeçalho do arquivo de trace, seguido de `capacity` registros. O mesmo
+// layout é usado em memória e no arquivo mapeado, então gravar um registro
+// custa o mesmo nos dois casos.
+typedef struct {
+        char magic[4];
+        uint16_t version;
+        uint16_t record_size;
+        uint32_t capacity;
+        uint32_t reserved;
+        // Total de registros já gravados; os últimos `capacity` estão no
+        // buffer, o registro N na posição N % capacity
+        uint64_t count;
+} TraceHeader;
+
+typedef struct TraceBuffer {
+        TraceHeader *header;
+        TraceRecord *records;
+        uint32_t mask;
+        // Região alocada ou mapeada, incluindo o cabeçalho
+        void *region;
+        size_t region_size;
+        bool mapped;
+} TraceBuffer;
+
+// Abre um buffer com pelo menos `capacity` registros. Com `path`, o buffer é
+// um arquivo mapeado em memória, que fica completo mesmo se o processo
+// terminar sem chamar `trace_close()`.
+bool trace_open(TraceBuffer *trace, uint32_t capacity, const char *path);
+// Abre um arquivo de trace existente, somente para leitura
+bool trace_load(TraceBuffer *trace, const char *path);
+void trace_close(TraceBuffer *trace);
+// Índice absoluto do registro mais antigo ainda no buffer
+uint64_t trace_first(const TraceBuffer *trace);
+
+static inline void trace_record(TraceBuffer *trace,
+                                const TraceRecord *record) {
+        trace->records[trace->header->count & trace->mask] = *record;
+        trace->header->count++;
+}
+
+// Registro de índice absoluto `index`, entre `trace_first()` e `count`
+static inline const TraceRecord *trace_at(const TraceBuffer *trace,
+                                          uint64_t index) {
+        return &trace->records[index & trace->mask];
+}
+
+#endif
@@ -0,0 +1,262 @@
+/*
+ * c8c-trace: lê os arquivos gravados com `c8c --trace-file`
+ *
+ *   c8c-trace dump <trace> [primeiro] [quantidade]
+ *   c8c-trace diff <trace A> <trace B>
+ */
+#include "trace.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Registros exibidos antes da primeira divergência
+#define DIFF_CONTEXT 8
+
+static void disassemble(uint16_t op_code, char *out, size_t size) {
+        const uint16_t address = op_code & 0x0FFF;
+        const uint8_t x = (op_code >> 8) & 0xF;
+        const uint8_t y = (op_code >> 4) & 0xF;
+        const uint8_t n = op_code & 0xF;
+        const uint8_t nn = op_code & 0xFF;
+
+        switch (op_code >> 12) {
+        case 0x0:
+                if (op_code == 0x00E0)
+                        snprintf(out, size, "CLS");
+                else if (op_code == 0x00EE)
+                        snprintf(out, size, "RET");
+                else if ((op_code & 0xFFF0) == 0x00C0)
+                        snprintf(out, size, "SCD %u", n);
+                else if (op_code == 0x00FB)
+                        snprintf(out, size, "SCR");
+                else if (op_code == 0x00FC)
+                        snprintf(out, size, "SCL");
+                else if (op_code == 0x00FD)
+                        snprintf(out, size, "EXIT");
+                else if (op_code == 0x00FE)
+                        snprintf(out, size, "LOW");
+                else if (op_code == 0x00FF)
+                        snprintf(out, size, "HIGH");
+                else
+                        snprintf(out, size, "SYS 0x%03X", address);
+                return;
+        case 0x1:
+                snprintf(out, size, "JP 0x%03X", address);
+                return;
+        case 0x2:
+                snprintf(out, size, "CALL 0x%03X", address);
+                return;
+        case 0x3:
+                snprintf(out, size, "SE V%X, 0x%02X", x, nn);
+                return;
+        case 0x4:
+                snprintf(out, size, "SNE V%X, 0x%02X", x, nn);
+                return;
+        case 0x5:
+                snprintf(out, size, "SE V%X, V%X", x, y);
+                return;
+        case 0x6:
+                snprintf(out, size, "LD V%X, 0x%02X", x, nn);
+                return;
+        case 0x7:
+                snprintf(out, size, "ADD V%X, 0x%02X", x, nn);
+                return;
+        case 0x8: {
+                static const char *const names[16] = {
+                    "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+                    NULL, NULL, NULL, NULL, NULL, NULL, "SHL", NULL,
+                };
+                if (names[n] != NULL) {
+                        snprintf(out, size, "%s V%X, V%X", names[n], x, y);
+                        return;
+                }
+                break;
+        }
+        case 0x9:
+                snprintf(out, size, "SNE V%X, V%X", x, y);
+                return;
+        case 0xA:
+                snprintf(out, size, "LD I, 0x%03X", address);
+                return;
+        case 0xB:
+                snprintf(out, size, "JP V0, 0x%03X", address);
+                return;
+        case 0xC:
+                snprintf(out, size, "RND V%X, 0x%02X", x, nn);
+                return;
+        case 0xD:
+                // Com n = 0, o sprite 16x16 do SUPER-CHIP
+                snprintf(out, size, "DRW V%X, V%X, %u", x, y, n);
+                return;
+        case 0xE:
+                if (nn == 0x9E) {
+                        snprintf(out, size, "SKP V%X", x);
+                        return;
+                }
+                if (nn == 0xA1) {
+                        snprintf(out, size, "SKNP V%X", x);
+                        return;
+                }
+                break;
+        case 0xF:
+                switch (nn) {
+                case 0x07:
+                        snprintf(out, size, "LD V%X, DT", x);
+                        return;
+                case 0x0A:
+                        snprintf(out, size, "LD V%X, K", x);
+                        return;
+                case 0x15:
+                        snprintf(out, size, "LD DT, V%X", x);
+                        return;
+                case 0x18:
+                        snprintf(out, size, "LD ST, V%X", x);
+                        return;
+                case 0x1E:
+                        snprintf(out, size, "ADD I, V%X", x);
+                        return;
+                case 0x29:
+                        snprintf(out, size, "LD F, V%X", x);
+                        return;
+                case 0x30:
+                        snprintf(out, size, "LD HF, V%X", x);
+                        return;
+                case 0x33:
+                        snprintf(out, size, "LD B, V%X", x);
+                        return;
+                case 0x55:
+                        snprintf(out, size, "LD [I], V%X", x);
+                        return;
+                case 0x65:
+                        snprintf(out, size, "LD V%X, [I]", x);
+                        return;
+                case 0x75:
+                        snprintf(out, size, "LD R, V%X", x);
+                        return;
+                case 0x85:
+                        snprintf(out, size, "LD V%X, R", x);
+                        return;
+                }
+                break;
+        }
+        snprintf(out, size, "??? 0x%04X", op_code);
+}
+
+static void print_record(const char *prefix, uint64_t index,
+                         const TraceRecord *record) {
+        char text[32];
+        disassemble(record->op_code, text, sizeof(text));
+
+        char change[16] = "";
+        if (record->changed_register != TRACE_NO_REGISTER) {
+                snprintf(change, sizeof(change), "V%X=0x%02X",
+                         record->changed_register, record->changed_value);
+        }
+        printf("%s%10" PRIu64 "  0x%03X  %04X  %-16s I=0x%03X  %-8s "
+               "VF=0x%02X\n",
+               prefix, index, record->program_counter, record->op_code, text,
+               record->index_register, change, record->flag);
+}
+
+static bool open_trace(TraceBuffer *trace, const char *path) {
+        if (!trace_load(trace, path)) {
+                fprintf(stderr, "Não foi possível ler o trace: %s\n", path);
+                return false;
+        }
+        return true;
+}
+
+static int dump(const char *path, uint64_t first, uint64_t count) {
+        TraceBuffer trace;
+        if (!open_trace(&trace, path))
+                return EXIT_FAILURE;
+
+        uint64_t end = trace.header->count;
+        if (first < trace_first(&trace))
+                first = trace_first(&trace);
+        if (count > 0 && first + count < end)
+                end = first + count;
+
+        for (uint64_t i = first; i < end; ++i) {
+                print_record("", i, trace_at(&trace, i));
+        }
+        trace_close(&trace);
+        return EXIT_SUCCESS;
+}
+
+static bool same_record(const TraceRecord *a, const TraceRecord *b) {
+        return a->program_counter == b->program_counter &&
+               a->op_code == b->op_code &&
+               a->index_register == b->index_register &&
+               a->changed_register == b->changed_register &&
+               a->changed_value == b->changed_value && a->flag == b->flag;
+}
+
+// Compara os registros presentes nos dois traces, pelo índice absoluto
+static int diff(const char *path_a, const char *path_b) {
+        TraceBuffer a;
+        TraceBuffer b;
+        if (!open_trace(&a, path_a))
+                return EXIT_FAILURE;
+        if (!open_trace(&b, path_b)) {
+                trace_close(&a);
+                return EXIT_FAILURE;
+        }
+
+        const uint64_t first_a = trace_first(&a);
+        const uint64_t first_b = trace_first(&b);
+        const uint64_t first = first_a > first_b ? first_a : first_b;
+        const uint64_t end = a.header->count < b.header->count
+                                 ? a.header->count
+                                 : b.header->count;
+
+        int result = EXIT_SUCCESS;
+        uint64_t i = first;
+        while (i < end && same_record(trace_at(&a, i), trace_at(&b, i))) {
+                i++;
+        }
+
+        if (i < end) {
+                printf("Primeira divergência no registro %" PRIu64 ":\n", i);
+                const uint64_t context =
+                    i - first > DIFF_CONTEXT ? i - DIFF_CONTEXT : first;
+                for (uint64_t j = context; j < i; ++j) {
+                        print_record("  ", j, trace_at(&a, j));
+                }
+                print_record("A ", i, trace_at(&a, i));
+                print_record("B ", i, trace_at(&b, i));
+                result = EXIT_FAILURE;
+        } else if (a.header->count != b.header->count) {
+                printf("%" PRIu64 " registros iguais a partir do %" PRIu64
+                       "; tamanhos diferentes (%" PRIu64 " e %" PRIu64 ")\n",
+                       end - first, first, a.header->count, b.header->count);
+                result = EXIT_FAILURE;
+        } else {
+                printf("%" PRIu64 " registros iguais a partir do %" PRIu64
+                       "\n",
+                       end - first, first);
+        }
+
+        trace_close(&a);
+        trace_close(&b);
+        return result;
+}
+
+int main(int argc, char *argv[]) {
+        if (argc >= 3 && strcmp(argv[1], "dump") == 0) {
+                const uint64_t first =
+                    argc >= 4 ? strtoull(argv[3], NULL, 0) : 0;
+                const uint64_t count =
+                    argc >= 5 ? strtoull(argv[4], NULL, 0) : 0;
+                return dump(argv[2], first, count);
+        }
+        if (argc == 4 && strcmp(argv[1], "diff") == 0) {
+                return diff(argv[2], argv[3]);
+        }
+
+        fprintf(stderr, "Uso: %s dump <trace> [primeiro] [quantidade]\n"
+                        "     %s diff <trace A> <trace B>\n",
+                argv[0], argv[0]);
+        return EXIT_FAILURE;
+}
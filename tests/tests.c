@@ -5,21 +5,121 @@
  * apontaram problemas no código original.
  * Possivelmente, implementarei mais testes no futuro.
  */
+#include "../src/decode_cache.h"
+#include "../src/jit.h"
+#include "../src/lockstep.h"
+#include "../src/movie.h"
+#include "../src/rewind.h"
+#include "../src/savestate.h"
 #include "../src/system.h"
+#include "../src/threaded.h"
+#include "../src/trace.h"
 #include <assert.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Instruções por tick de 60Hz ao rodar as ROMs nos testes
+#define TEST_INSTRUCTIONS_PER_FRAME 8
 
 void test_registers(Chip8 *chip8);
+void test_draw_sprite(Chip8 *chip8);
+void test_decode_cache_invalidation(void);
+void test_jit_invalidation(void);
+void test_cycle_timers(void);
+void test_trace(void);
+void test_savestate(void);
+void test_rewind(size_t arena_size);
+void test_engines_match(const char *rom, uint8_t platform,
+                        QuirkProfile quirks, uint32_t cycles,
+                        uint64_t expected_display);
+void test_lockstep(const char *rom, uint32_t cycles);
+void test_faults(void);
+void test_run(void);
+void test_random(void);
+void test_keypad(void);
+void test_movie(void);
+void test_idle_loops(void);
+void test_address_wrap(void);
+void test_quirks(QuirkProfile quirks);
+void test_superchip(void);
 
 int main(void) {
         Chip8 chip8 = {0};
         reset(&chip8);
 
         test_registers(&chip8);
+        test_draw_sprite(&chip8);
+        test_decode_cache_invalidation();
+        test_jit_invalidation();
+        test_cycle_timers();
+        test_trace();
+        test_savestate();
+        test_rewind(1 << 20);
+        // Arena pequena: os quadros mais antigos são descartados
+        test_rewind(3 * SAVESTATE_SIZE);
+        test_faults();
+        test_run();
+        test_random();
+        test_keypad();
+        test_movie();
+        test_idle_loops();
+        test_address_wrap();
+        test_quirks(QUIRKS_CHIP8);
+        test_quirks(QUIRKS_SCHIP);
+        test_quirks(QUIRKS_XOCHIP);
+        test_superchip();
+        // Os hashes são das telas finais conferidas à mão: todos os testes
+        // marcados como corretos, e as setas da rolagem nas suas caixas
+        test_engines_match("tests/timendus/3-corax+.ch8", 0, QUIRKS_CHIP8,
+                           20000, 0xF331B661EB5802EA);
+        // O teste de quirks aceita a plataforma pré-selecionada em 0x1FF
+        test_engines_match("tests/timendus/5-quirks.ch8", 1, QUIRKS_CHIP8,
+                           200000, 0x12CA962350705A09);
+        test_engines_match("tests/timendus/5-quirks.ch8", 2, QUIRKS_SCHIP,
+                           200000, 0x758FBCBE01DF9EF5);
+        test_engines_match("tests/timendus/5-quirks.ch8", 3, QUIRKS_XOCHIP,
+                           200000, 0xCD803349BC56B030);
+        // Rolagem do SUPER-CHIP em baixa e em alta resolução
+        test_engines_match("tests/timendus/8-scrolling.ch8", 1, QUIRKS_SCHIP,
+                           20000, 0xC3B1E269CD6B53F8);
+        test_engines_match("tests/timendus/8-scrolling.ch8", 3, QUIRKS_SCHIP,
+                           20000, 0x5092D23C32841D4B);
+        test_lockstep("tests/timendus/5-quirks.ch8", 200000);
+        // Programa aleatório: as instâncias divergem e voltam a se juntar
+        test_lockstep(NULL, 20000);
 
         return 0;
 }
 
+static void load_rom(Chip8 *chip8, const char *path) {
+        static uint8_t program[MEMORY_SIZE - PROGRAM_START];
+
+        FILE *file = fopen(path, "rb");
+        assert(file != NULL);
+        const size_t size = fread(program, 1, sizeof(program), file);
+        fclose(file);
+
+        init(chip8, program, size);
+}
+
+static void assert_same_state(const Chip8 *a, const Chip8 *b) {
+        assert(a->program_counter == b->program_counter);
+        assert(a->index_register == b->index_register);
+        assert(a->stack_pointer == b->stack_pointer);
+        assert(a->delay_timer == b->delay_timer);
+        assert(a->sound_timer == b->sound_timer);
+        assert(memcmp(a->registers, b->registers, sizeof(a->registers)) == 0);
+        assert(memcmp(a->stack, b->stack, sizeof(a->stack)) == 0);
+        assert(memcmp(a->memory, b->memory, sizeof(a->memory)) == 0);
+        assert(memcmp(a->rpl_flags, b->rpl_flags, sizeof(a->rpl_flags)) == 0);
+        assert(display_hash(a) == display_hash(b));
+        assert(a->cycle_count == b->cycle_count);
+        assert(a->instructions_until_tick == b->instructions_until_tick);
+}
+
 void test_registers(Chip8 *chip8) {
         // Inicio dos testes
         // Testes de adição sem overflow
@@ -27,7 +127,7 @@ void test_registers(Chip8 *chip8) {
         add_to_register(chip8, 6, 10);
         assert(chip8->registers[6] == 9);
 
-        set_rshift(chip8, 6);
+        set_rshift(chip8, 6, 6);
         assert(chip8->registers[6] == 4);
 
         set_register(chip8, 6, 255);
@@ -35,18 +135,28 @@ void test_registers(Chip8 *chip8) {
         set_add(chip8, 6, 0);
         assert(chip8->registers[6] == 9);
 
-        set_rshift(chip8, 6);
+        set_rshift(chip8, 6, 6);
         assert(chip8->registers[6] == 4);
 
         // Testes dos operadores de bit-shift
         set_register(chip8, 6, 255);
-        set_lshift(chip8, 6);
-        set_rshift(chip8, 6);
+        set_lshift(chip8, 6, 6);
+        set_rshift(chip8, 6, 6);
         assert(chip8->registers[6] == 127);
-        set_rshift(chip8, 6);
-        set_lshift(chip8, 6);
+        set_rshift(chip8, 6, 6);
+        set_lshift(chip8, 6, 6);
         assert(chip8->registers[6] == 126);
 
+        // VF recebe o bit que saiu, inclusive o bit 7 de 0x80
+        set_register(chip8, 6, 0x80);
+        set_lshift(chip8, 6, 6);
+        assert(chip8->registers[6] == 0 && chip8->registers[0xF] == 1);
+        // Deslocando o VY para o VX
+        set_register(chip8, 1, 0x03);
+        set_rshift(chip8, 6, 1);
+        assert(chip8->registers[6] == 0x01 && chip8->registers[0xF] == 1);
+        assert(chip8->registers[1] == 0x03);
+
         // Testes de subtração
         set_register(chip8, 6, 5);
         add_to_register(chip8, 6, 0xF6);
@@ -59,4 +169,1104 @@ void test_registers(Chip8 *chip8) {
         set_register(chip8, 6, 5);
         set_subn(chip8, 0, 6);
         assert(chip8->registers[0] == 251);
-}
\ No newline at end of file
+}
+
+void test_draw_sprite(Chip8 *chip8) {
+        uint8_t program[] = {0x00};
+        init(chip8, program, 0);
+
+        // Caractere "0" (F0 90 90 90 F0) na coluna 62: dá a volta na borda
+        set_register(chip8, 0, 62);
+        set_register(chip8, 1, 30);
+        set_register(chip8, 2, 0);
+        load_sprite_font(chip8, 2);
+        draw_sprite(chip8, 0, 1, 5);
+        assert(chip8->registers[0xF] == 0);
+        assert(display_pixel(chip8, 62, 30));
+        assert(display_pixel(chip8, 63, 30));
+        assert(display_pixel(chip8, 0, 30));
+        assert(display_pixel(chip8, 1, 30));
+        assert(!display_pixel(chip8, 2, 30));
+        // A linha 32 volta para o topo
+        assert(display_pixel(chip8, 62, 0));
+        assert(!display_pixel(chip8, 63, 0));
+        assert(display_pixel(chip8, 1, 0));
+
+        // Desenhar de novo apaga tudo e sinaliza colisão
+        draw_sprite(chip8, 0, 1, 5);
+        assert(chip8->registers[0xF] == 1);
+        for (uint8_t y = 0; y < DISPLAY_HEIGHT; ++y) {
+                for (uint8_t w = 0; w < DISPLAY_WORDS; ++w)
+                        assert(chip8->display[y][w] == 0);
+        }
+
+        draw_sprite(chip8, 0, 1, 5);
+        clear_display(chip8);
+        assert(chip8->display[30][0] == 0);
+}
+
+void test_decode_cache_invalidation(void) {
+        static Chip8 chip8;
+        static DecodeCache cache;
+        const uint8_t program[] = {0x65, 0x05}; // V5 = 0x05
+
+        init(&chip8, (uint8_t *)program, sizeof(program));
+        decode_cache_attach(&cache, &chip8);
+
+        step_cached(&chip8, &cache);
+        assert(chip8.registers[5] == 0x05);
+
+        // Reescreve a instrução com Fx55: V5 = 0x09
+        chip8.registers[0] = 0x65;
+        chip8.registers[1] = 0x09;
+        chip8.index_register = PROGRAM_START;
+        store_registers(&chip8, 1);
+
+        chip8.program_counter = PROGRAM_START;
+        step_cached(&chip8, &cache);
+        assert(chip8.registers[5] == 0x09);
+
+        // Reescreve só o segundo byte com Fx33: 123 -> V5 = 0x01
+        chip8.registers[0] = 123;
+        chip8.index_register = PROGRAM_START + 1;
+        store_bcd(&chip8, 0);
+
+        chip8.program_counter = PROGRAM_START;
+        step_cached(&chip8, &cache);
+        assert(chip8.registers[5] == 0x01);
+
+        // Outra ROM com o cache ligado: nada decodificado da anterior fica
+        const uint8_t other[] = {0x65, 0x07}; // V5 = 0x07
+        init(&chip8, (uint8_t *)other, sizeof(other));
+        step_cached(&chip8, &cache);
+        assert(chip8.registers[5] == 0x07);
+
+        decode_cache_detach(&chip8);
+}
+
+void test_jit_invalidation(void) {
+        static Chip8 chip8;
+        static JitCache cache;
+        // V5 = 0x05; V6 += 0x01; salta para si mesmo
+        const uint8_t program[] = {0x65, 0x05, 0x76, 0x01, 0x12, 0x04};
+
+        init(&chip8, (uint8_t *)program, sizeof(program));
+        if (!jit_attach(&cache, &chip8))
+                return;
+
+        assert(run_jit(&chip8, &cache, 3) == 3);
+        assert(chip8.registers[5] == 0x05);
+        assert(chip8.registers[6] == 0x01);
+
+        // Reescreve a primeira instrução do bloco com Fx55: V5 = 0x09
+        chip8.registers[0] = 0x65;
+        chip8.registers[1] = 0x09;
+        chip8.index_register = PROGRAM_START;
+        store_registers(&chip8, 1);
+
+        // Orçamento menor que o bloco: sai no meio dele
+        chip8.program_counter = PROGRAM_START;
+        assert(run_jit(&chip8, &cache, 1) == 1);
+        assert(chip8.registers[5] == 0x09);
+        assert(chip8.registers[6] == 0x01);
+        assert(chip8.program_counter == PROGRAM_START + 2);
+
+        // Outra ROM com o cache ligado: nenhum bloco da anterior fica
+        const uint8_t other[] = {0x65, 0x07, 0x76, 0x02, 0x12, 0x04};
+        init(&chip8, (uint8_t *)other, sizeof(other));
+        assert(run_jit(&chip8, &cache, 3) == 3);
+        assert(chip8.registers[5] == 0x07);
+        assert(chip8.registers[6] == 0x02);
+
+        jit_detach(&cache, &chip8);
+}
+
+// Executa a mesma ROM com `step()` e com os demais núcleos e compara o
+// estado. A tela final do `step()` também precisa ser a esperada, para que
+// um erro comum a todos os núcleos não passe.
+void test_engines_match(const char *rom, uint8_t platform,
+                        QuirkProfile quirks, uint32_t cycles,
+                        uint64_t expected_display) {
+        static Chip8 reference;
+        static Chip8 cached;
+        static Chip8 threaded;
+        static Chip8 jit;
+        static Chip8 ran;
+        static DecodeCache cache;
+        static JitCache jit_cache;
+
+        load_rom(&ran, rom);
+        load_rom(&reference, rom);
+        load_rom(&cached, rom);
+        load_rom(&threaded, rom);
+        load_rom(&jit, rom);
+        if (platform != 0) {
+                reference.memory[0x1FF] = platform;
+                cached.memory[0x1FF] = platform;
+                threaded.memory[0x1FF] = platform;
+                jit.memory[0x1FF] = platform;
+                ran.memory[0x1FF] = platform;
+        }
+        set_instructions_per_tick(&reference, TEST_INSTRUCTIONS_PER_FRAME);
+        set_instructions_per_tick(&cached, TEST_INSTRUCTIONS_PER_FRAME);
+        set_instructions_per_tick(&threaded, TEST_INSTRUCTIONS_PER_FRAME);
+        set_instructions_per_tick(&jit, TEST_INSTRUCTIONS_PER_FRAME);
+        set_instructions_per_tick(&ran, TEST_INSTRUCTIONS_PER_FRAME);
+        set_quirk_profile(&reference, quirks);
+        set_quirk_profile(&cached, quirks);
+        set_quirk_profile(&threaded, quirks);
+        set_quirk_profile(&jit, quirks);
+        set_quirk_profile(&ran, quirks);
+        decode_cache_attach(&cache, &cached);
+        jit_attach(&jit_cache, &jit);
+
+        for (uint32_t i = 0; i < cycles; ++i) {
+                step(&reference);
+                step_cached(&cached, &cache);
+        }
+        // Lotes que não coincidem com os ticks: os timers devem avançar no
+        // mesmo ponto que no `step()`
+        for (uint32_t executed = 0; executed < cycles;) {
+                const uint32_t batch =
+                    cycles - executed < 1000 ? cycles - executed : 1000;
+                assert(run_threaded(&threaded, batch) == batch);
+                assert(run_jit(&jit, &jit_cache, batch) == batch);
+                executed += batch;
+                // `run()` volta a cada evento; continua até completar o lote
+                while (ran.cycle_count < executed) {
+                        assert(run(&ran, executed - ran.cycle_count) !=
+                               RUN_FAULT);
+                }
+        }
+        assert(display_hash(&reference) == expected_display);
+        assert_same_state(&reference, &cached);
+        assert_same_state(&reference, &threaded);
+        assert_same_state(&reference, &jit);
+        assert_same_state(&reference, &ran);
+
+        decode_cache_detach(&cached);
+        jit_detach(&jit_cache, &jit);
+}
+
+// Os timers avançam a cada `instructions_per_tick` instruções, em qualquer
+// núcleo e independente do tamanho dos lotes
+void test_cycle_timers(void) {
+        static JitCache jit_cache;
+        // V0 = 3; DT = V0; laço infinito
+        static const uint8_t program[] = {0x60, 0x03, 0xF0, 0x15, 0x12, 0x04};
+        Chip8 chip8 = {0};
+        set_instructions_per_tick(&chip8, 4);
+        init(&chip8, (uint8_t *)program, sizeof(program));
+
+        step(&chip8);
+        step(&chip8);
+        assert(chip8.delay_timer == 3);
+        assert(chip8.cycle_count == 2);
+
+        step(&chip8);
+        step(&chip8);
+        assert(chip8.delay_timer == 2);
+
+        // Ticks nas instruções 8 e 12
+        assert(run_threaded(&chip8, 9) == 9);
+        assert(chip8.delay_timer == 0);
+        assert(chip8.cycle_count == 13);
+        assert(chip8.instructions_until_tick == 3);
+
+        // O mesmo programa pelo JIT, parando no meio de um bloco
+        init(&chip8, (uint8_t *)program, sizeof(program));
+        jit_attach(&jit_cache, &chip8);
+        assert(run_jit(&chip8, &jit_cache, 5) == 5);
+        assert(chip8.delay_timer == 2);
+        assert(run_jit(&chip8, &jit_cache, 3) == 3);
+        assert(chip8.delay_timer == 1);
+        jit_detach(&jit_cache, &chip8);
+}
+
+// O trace guarda as últimas instruções executadas pelo `step()`, com o
+// registrador alterado por cada uma
+void test_trace(void) {
+        // V1 = 0xFF; V1 += 1; V1 += V1 (VF = 0); laço infinito
+        static const uint8_t program[] = {0x61, 0xFF, 0x71, 0x01,
+                                          0x81, 0x14, 0x12, 0x06};
+        Chip8 chip8 = {0};
+        TraceBuffer trace;
+        init(&chip8, (uint8_t *)program, sizeof(program));
+        assert(trace_open(&trace, 3, NULL));
+        assert(trace.header->capacity == 4);
+        chip8.trace = &trace;
+
+        for (uint8_t i = 0; i < 6; ++i) {
+                step(&chip8);
+        }
+        assert(trace.header->count == 6);
+        assert(trace_first(&trace) == 2);
+
+        const TraceRecord *add = trace_at(&trace, 2);
+        assert(add->program_counter == PROGRAM_START + 4);
+        assert(add->op_code == 0x8114);
+        assert(add->changed_register == TRACE_NO_REGISTER);
+        assert(add->flag == 0);
+
+        const TraceRecord *jump = trace_at(&trace, 5);
+        assert(jump->program_counter == PROGRAM_START + 6);
+        assert(jump->op_code == 0x1206);
+
+        // A instrução mais antiga foi sobrescrita pela mais recente
+        chip8.program_counter = PROGRAM_START;
+        step(&chip8);
+        const TraceRecord *load = trace_at(&trace, 6);
+        assert(load == trace_at(&trace, 2));
+        assert(load->changed_register == 1);
+        assert(load->changed_value == 0xFF);
+
+        trace_close(&trace);
+}
+
+// Restaurar um estado salvo e continuar a execução leva ao mesmo resultado
+// que nunca ter parado, mesmo num núcleo com cache de instruções
+void test_savestate(void) {
+        static Chip8 original;
+        static Chip8 restored;
+        static DecodeCache cache;
+        static uint8_t buffer[SAVESTATE_SIZE];
+
+        load_rom(&original, "tests/timendus/3-corax+.ch8");
+        set_instructions_per_tick(&original, TEST_INSTRUCTIONS_PER_FRAME);
+        // O perfil faz parte do estado
+        set_quirk_profile(&original, QUIRKS_XOCHIP);
+        for (uint32_t i = 0; i < 1001; ++i) {
+                step(&original);
+        }
+        savestate_write(&original, buffer);
+
+        // Outra ROM já decodificada no cache, que precisa ser descartada
+        load_rom(&restored, "tests/timendus/5-quirks.ch8");
+        decode_cache_attach(&cache, &restored);
+        for (uint32_t i = 0; i < 100; ++i) {
+                step_cached(&restored, &cache);
+        }
+        assert(savestate_read(&restored, buffer, sizeof(buffer)));
+
+        for (uint32_t i = 0; i < 5000; ++i) {
+                step(&original);
+                step_cached(&restored, &cache);
+        }
+        assert_same_state(&original, &restored);
+        decode_cache_detach(&restored);
+
+        // Versão desconhecida ou tamanho errado não alteram a máquina
+        buffer[SAVESTATE_OFFSET_VERSION]++;
+        assert(!savestate_read(&restored, buffer, sizeof(buffer)));
+        buffer[SAVESTATE_OFFSET_VERSION]--;
+        assert(!savestate_read(&restored, buffer, sizeof(buffer) - 1));
+        buffer[SAVESTATE_OFFSET_QUIRKS] = QUIRK_PROFILE_COUNT;
+        assert(!savestate_read(&restored, buffer, sizeof(buffer)));
+        assert_same_state(&original, &restored);
+        assert(restored.quirks == QUIRKS_XOCHIP);
+}
+
+// Voltar quadro a quadro reproduz exatamente os estados de cada quadro, do
+// mais recente até o mais antigo ainda guardado
+void test_rewind(size_t arena_size) {
+        enum { FRAMES = 400 };
+        static Chip8 chip8;
+        static Rewind rewind;
+        static uint8_t states[FRAMES][SAVESTATE_SIZE];
+        static uint8_t restored[SAVESTATE_SIZE];
+
+        load_rom(&chip8, "tests/timendus/3-corax+.ch8");
+        set_instructions_per_tick(&chip8, TEST_INSTRUCTIONS_PER_FRAME);
+        assert(rewind_init(&rewind, arena_size, FRAMES, 7));
+
+        for (uint32_t frame = 0; frame < FRAMES; ++frame) {
+                for (uint32_t i = 0; i < TEST_INSTRUCTIONS_PER_FRAME; ++i) {
+                        step(&chip8);
+                }
+                savestate_write(&chip8, states[frame]);
+                rewind_push(&rewind, &chip8);
+        }
+
+        uint32_t frame = FRAMES - 1;
+        while (rewind_pop(&rewind, &chip8)) {
+                frame--;
+                savestate_write(&chip8, restored);
+                assert(memcmp(restored, states[frame], SAVESTATE_SIZE) == 0);
+        }
+        if (arena_size >= (1 << 20))
+                assert(frame == 0);
+        else
+                assert(frame > 0 && frame < FRAMES - 1);
+
+        // Depois de voltar, o histórico continua de onde parou
+        for (uint32_t i = 0; i < TEST_INSTRUCTIONS_PER_FRAME; ++i) {
+                step(&chip8);
+        }
+        rewind_push(&rewind, &chip8);
+        assert(rewind_pop(&rewind, &chip8));
+        savestate_write(&chip8, restored);
+        assert(memcmp(restored, states[frame], SAVESTATE_SIZE) == 0);
+
+        rewind_free(&rewind);
+}
+
+static uint32_t xorshift(uint32_t *state) {
+        *state ^= *state << 13;
+        *state ^= *state >> 17;
+        *state ^= *state << 5;
+        return *state;
+}
+
+// Programa só com instruções que não acessam a memória nem a pilha, com
+// pulos condicionais que separam as instâncias e saltos que as juntam de novo
+static size_t random_program(uint8_t *program, size_t size, uint32_t seed) {
+        static const uint16_t ARITHMETIC[] = {0x0, 0x1, 0x2, 0x3, 0x4,
+                                              0x5, 0x6, 0x7, 0xE};
+        static const uint8_t TIMERS[] = {0x07, 0x15, 0x18, 0x1E, 0x29};
+
+        for (size_t pc = 0; pc < size; pc += 2) {
+                const uint32_t r = xorshift(&seed);
+                const uint16_t x = (r >> 8) & 0xF;
+                const uint16_t y = (r >> 12) & 0xF;
+                uint16_t op_code;
+                switch (r % 10) {
+                case 0: {
+                        // Só para frente, para o programa todo ser executado
+                        size_t target = pc + 2 + ((r >> 16) % 16) * 2;
+                        if (target >= size)
+                                target = 0;
+                        op_code = 0x1000 | (PROGRAM_START + target);
+                        break;
+                }
+                case 1:
+                        op_code = 0x3000 | (x << 8) | ((r >> 16) & 0x3);
+                        break;
+                case 2:
+                        op_code = 0x4000 | (x << 8) | ((r >> 16) & 0x3);
+                        break;
+                case 3:
+                        op_code = ((r >> 16) & 1 ? 0x5000 : 0x9000) |
+                                  (x << 8) | (y << 4);
+                        break;
+                case 4:
+                        op_code = 0x6000 | (x << 8) | ((r >> 16) & 0xFF);
+                        break;
+                case 5:
+                        op_code = 0x7000 | (x << 8) | ((r >> 16) & 0xFF);
+                        break;
+                case 6:
+                case 7:
+                        op_code = 0x8000 | (x << 8) | (y << 4) |
+                                  ARITHMETIC[(r >> 16) % 9];
+                        break;
+                case 8:
+                        // Sem Bnnn: o destino depende de registradores
+                        // quaisquer e cairia fora do programa
+                        op_code = 0xA000 | ((r >> 16) & 0xFFF);
+                        break;
+                default:
+                        op_code = 0xF000 | (x << 8) | TIMERS[(r >> 16) % 5];
+                        break;
+                }
+                program[pc] = op_code >> 8;
+                program[pc + 1] = op_code & 0xFF;
+        }
+        // Volta ao início no fim do programa
+        program[size - 2] = 0x10 | (PROGRAM_START >> 8);
+        program[size - 1] = PROGRAM_START & 0xFF;
+        return size;
+}
+
+// Cada instância do lockstep termina no mesmo estado que uma máquina
+// executando sozinha com `step()`, com as instâncias divergindo por causa dos
+// registradores iniciais (ou da plataforma escolhida no teste de quirks)
+void test_lockstep(const char *rom, uint32_t cycles) {
+        static Lockstep lockstep;
+        static Chip8 reference[LOCKSTEP_LANES];
+        static Chip8 lane;
+        static uint8_t program[0x200];
+
+        size_t program_size = 0;
+        if (rom == NULL)
+                program_size = random_program(program, sizeof(program), 1);
+        lockstep_init(&lockstep, LOCKSTEP_LANES, program, program_size,
+                      TEST_INSTRUCTIONS_PER_FRAME);
+
+        uint32_t seed = 2;
+        for (uint32_t l = 0; l < LOCKSTEP_LANES; ++l) {
+                Chip8 *chip8 = &reference[l];
+                // Instâncias de perfis diferentes nunca são agrupadas
+                set_quirk_profile(chip8, l % QUIRK_PROFILE_COUNT);
+                if (rom != NULL) {
+                        load_rom(chip8, rom);
+                        chip8->memory[0x1FF] = 1 + l % 4;
+                } else {
+                        init(chip8, program, program_size);
+                        for (uint8_t i = 0; i < REGISTER_COUNT; ++i) {
+                                chip8->registers[i] = xorshift(&seed) & 0x83;
+                        }
+                }
+                set_instructions_per_tick(chip8, TEST_INSTRUCTIONS_PER_FRAME);
+                lockstep_write_lane(&lockstep, l, chip8);
+        }
+
+        for (uint32_t executed = 0; executed < cycles;) {
+                const uint32_t batch =
+                    cycles - executed < 1000 ? cycles - executed : 1000;
+                for (uint32_t l = 0; l < LOCKSTEP_LANES; ++l) {
+                        for (uint32_t i = 0; i < batch; ++i) {
+                                step(&reference[l]);
+                        }
+                }
+                lockstep_run(&lockstep, batch);
+                executed += batch;
+
+                for (uint32_t l = 0; l < LOCKSTEP_LANES; ++l) {
+                        lockstep_read_lane(&lockstep, l, &lane);
+                        assert_same_state(&reference[l], &lane);
+                }
+        }
+}
+
+// Roda `program` em todos os núcleos e confere que todos param na mesma
+// instrução, sem executá-la
+static void assert_fault(const uint8_t *program, size_t size, Fault fault,
+                         uint16_t pc, uint64_t cycles) {
+        static Chip8 reference;
+        static Chip8 cached;
+        static Chip8 threaded;
+        static Chip8 jit;
+        static DecodeCache cache;
+        static JitCache jit_cache;
+
+        init(&reference, (uint8_t *)program, size);
+        init(&cached, (uint8_t *)program, size);
+        init(&threaded, (uint8_t *)program, size);
+        init(&jit, (uint8_t *)program, size);
+        decode_cache_attach(&cache, &cached);
+        jit_attach(&jit_cache, &jit);
+
+        uint64_t executed = 0;
+        while (executed < 100 && step(&reference) == FAULT_NONE) {
+                executed++;
+        }
+        assert(executed == cycles);
+        while (step_cached(&cached, &cache) == FAULT_NONE) {
+        }
+        assert(run_threaded(&threaded, 100) == cycles);
+        assert(run_jit(&jit, &jit_cache, 100) == cycles);
+
+        assert(reference.trap.fault == fault);
+        assert(reference.trap.program_counter == pc);
+        assert(reference.program_counter == pc);
+        assert(reference.cycle_count == cycles);
+        assert(memcmp(&reference.trap, &cached.trap, sizeof(Trap)) == 0);
+        assert(memcmp(&reference.trap, &threaded.trap, sizeof(Trap)) == 0);
+        assert(memcmp(&reference.trap, &jit.trap, sizeof(Trap)) == 0);
+        assert_same_state(&reference, &cached);
+        assert_same_state(&reference, &threaded);
+        assert_same_state(&reference, &jit);
+
+        // Parada: nada mais executa até o reset
+        assert(step(&reference) == fault);
+        assert(run_threaded(&threaded, 10) == 0);
+        assert(reference.cycle_count == cycles);
+
+        decode_cache_detach(&cached);
+        jit_detach(&jit_cache, &jit);
+}
+
+// Erros da ROM param só a instância, sem encerrar o processo
+void test_faults(void) {
+        // 00EE com a pilha vazia
+        static const uint8_t underflow[] = {0x60, 0x01, 0x00, 0xEE};
+        assert_fault(underflow, sizeof(underflow), FAULT_STACK_UNDERFLOW,
+                     0x202, 1);
+
+        // Chamada recursiva até encher a pilha
+        static const uint8_t overflow[] = {0x70, 0x01, 0x22, 0x00};
+        assert_fault(overflow, sizeof(overflow), FAULT_STACK_OVERFLOW, 0x202,
+                     2 * (STACK_DEPTH - 1) + 1);
+
+        // 8XYF não existe
+        static const uint8_t invalid[] = {0x60, 0x01, 0x61, 0x02, 0x80, 0x1F};
+        assert_fault(invalid, sizeof(invalid), FAULT_INVALID_INSTRUCTION,
+                     0x204, 2);
+
+        // Depois da última instrução da memória, a próxima não cabe nela
+        static const uint8_t fetch[] = {0x6A, 0x01, 0x1F, 0xFE};
+        assert_fault(fetch, sizeof(fetch), FAULT_INVALID_ADDRESS, 0x1000, 3);
+
+        // No lockstep, só a instância com V0 != 0 chega ao 00EE
+        static const uint8_t lanes[] = {0x30, 0x00, 0x00, 0xEE, 0x12, 0x04};
+        static Lockstep lockstep;
+        static Chip8 reference[2];
+        static Chip8 lane;
+        lockstep_init(&lockstep, 2, (uint8_t *)lanes, sizeof(lanes), 4);
+        for (uint32_t l = 0; l < 2; ++l) {
+                set_instructions_per_tick(&reference[l], 4);
+                init(&reference[l], (uint8_t *)lanes, sizeof(lanes));
+                reference[l].registers[0] = l;
+                reference[l].delay_timer = 10;
+                lockstep_write_lane(&lockstep, l, &reference[l]);
+                for (uint32_t i = 0; i < 20; ++i) {
+                        step(&reference[l]);
+                }
+        }
+        lockstep_run(&lockstep, 20);
+        assert(reference[1].trap.fault == FAULT_STACK_UNDERFLOW);
+        for (uint32_t l = 0; l < 2; ++l) {
+                lockstep_read_lane(&lockstep, l, &lane);
+                assert(lane.trap.fault == reference[l].trap.fault);
+                assert_same_state(&reference[l], &lane);
+        }
+}
+
+// `run()` para em cada evento, com o relógio contando só o que executou
+void test_run(void) {
+        static const uint8_t program[] = {
+            0x60, 0x05, // 200: V0 = 5
+            0x00, 0xE0, // 202: limpa a tela
+            0xF0, 0x18, // 204: ST = V0
+            0x61, 0x01, // 206: V1 = 1 (breakpoint)
+            0xF2, 0x0A, // 208: espera uma tecla
+            0xD0, 0x01, // 20A: desenha
+            0x12, 0x0C, // 20C: laço
+        };
+        static Breakpoints breakpoints;
+        Chip8 chip8 = {0};
+        init(&chip8, (uint8_t *)program, sizeof(program));
+        set_breakpoint(&breakpoints, 0x206, true);
+        chip8.breakpoints = &breakpoints;
+
+        assert(run(&chip8, 1) == RUN_BUDGET);
+        assert(run(&chip8, 100) == RUN_DISPLAY);
+        assert(chip8.cycle_count == 2);
+        assert(run(&chip8, 100) == RUN_SOUND);
+        assert(chip8.sound_timer == 5);
+        assert(run(&chip8, 100) == RUN_BREAKPOINT);
+        assert(chip8.program_counter == 0x206 && chip8.cycle_count == 3);
+        // Continuar do breakpoint executa a instrução dele
+        assert(run(&chip8, 100) == RUN_WAITING_KEY);
+        assert(chip8.program_counter == 0x208 && chip8.cycle_count == 5);
+        assert(run(&chip8, 100) == RUN_WAITING_KEY);
+        assert(chip8.cycle_count == 6);
+
+        // A tecla só é entregue ao ser solta
+        chip8.keypad = 1 << 3;
+        assert(run(&chip8, 100) == RUN_WAITING_KEY);
+        chip8.keypad = 0;
+        assert(run(&chip8, 100) == RUN_DISPLAY);
+        assert(chip8.registers[2] == 3);
+        assert(run(&chip8, 100) == RUN_BUDGET);
+        assert(chip8.cycle_count == 109);
+
+        // Parado em um breakpoint, o host leva o PC a outro: ele também para
+        init(&chip8, (uint8_t *)program, sizeof(program));
+        set_breakpoint(&breakpoints, 0x202, true);
+        assert(run(&chip8, 100) == RUN_BREAKPOINT);
+        assert(chip8.program_counter == 0x202);
+        chip8.program_counter = 0x206;
+        assert(run(&chip8, 100) == RUN_BREAKPOINT);
+        assert(chip8.program_counter == 0x206);
+        assert(run(&chip8, 100) == RUN_WAITING_KEY);
+        chip8.program_counter = 0x202;
+        assert(run(&chip8, 100) == RUN_BREAKPOINT);
+        assert(chip8.program_counter == 0x202);
+        set_breakpoint(&breakpoints, 0x202, false);
+
+        set_breakpoint(&breakpoints, 0x206, false);
+        chip8.breakpoints = NULL;
+        static const uint8_t fault[] = {0x00, 0xEE};
+        init(&chip8, (uint8_t *)fault, sizeof(fault));
+        assert(run(&chip8, 100) == RUN_FAULT);
+        assert(chip8.cycle_count == 0);
+}
+
+// O CxNN depende só da semente de cada instância, em qualquer núcleo
+void test_random(void) {
+        // V0 = aleatório; V1 += V0 (VF = carry); laço
+        static const uint8_t program[] = {0xC0, 0xFF, 0x81, 0x04, 0x12, 0x00};
+        static Chip8 reference;
+        static Chip8 cached;
+        static Chip8 threaded;
+        static Chip8 other;
+        static DecodeCache cache;
+        static uint8_t state[SAVESTATE_SIZE];
+
+        set_random_seed(&reference, 42);
+        set_random_seed(&cached, 42);
+        set_random_seed(&threaded, 42);
+        set_random_seed(&other, 43);
+        init(&reference, (uint8_t *)program, sizeof(program));
+        init(&cached, (uint8_t *)program, sizeof(program));
+        init(&threaded, (uint8_t *)program, sizeof(program));
+        init(&other, (uint8_t *)program, sizeof(program));
+        decode_cache_attach(&cache, &cached);
+
+        for (uint32_t i = 0; i < 3000; ++i) {
+                step(&reference);
+                step_cached(&cached, &cache);
+                step(&other);
+        }
+        assert(run_threaded(&threaded, 3000) == 3000);
+        assert_same_state(&reference, &cached);
+        assert_same_state(&reference, &threaded);
+        assert(memcmp(reference.registers, other.registers,
+                      sizeof(reference.registers)) != 0);
+        decode_cache_detach(&cached);
+
+        // Um estado salvo continua a mesma sequência
+        savestate_write(&reference, state);
+        for (uint32_t i = 0; i < 300; ++i) {
+                step(&reference);
+        }
+        assert(savestate_read(&other, state, sizeof(state)));
+        for (uint32_t i = 0; i < 300; ++i) {
+                step(&other);
+        }
+        assert_same_state(&reference, &other);
+
+        // O reset volta ao início da sequência da semente
+        reset(&reference);
+        memcpy(&reference.memory[PROGRAM_START], program, sizeof(program));
+        for (uint32_t i = 0; i < 3000; ++i) {
+                step(&reference);
+        }
+        assert(memcmp(reference.registers, threaded.registers,
+                      sizeof(reference.registers)) == 0);
+}
+
+// Teclas continuam pressionadas entre instruções; Fx0A entrega a tecla quando
+// ela é solta
+void test_keypad(void) {
+        static const uint8_t program[] = {
+            0x60, 0x07, // 200: V0 = 7
+            0xE0, 0x9E, // 202: pula se a tecla V0 estiver pressionada
+            0x00, 0x00, // 204: (pulado)
+            0xE0, 0x9E, // 206: pula de novo, com a tecla ainda pressionada
+            0x00, 0x00, // 208: (pulado)
+            0xF1, 0x0A, // 20A: espera uma tecla
+            0x12, 0x0C, // 20C: laço
+        };
+        static Chip8 chip8;
+        static Chip8 loaded;
+        static uint8_t state[SAVESTATE_SIZE];
+        init(&chip8, (uint8_t *)program, sizeof(program));
+
+        chip8.keypad = 1 << 7;
+        step(&chip8);
+        step(&chip8);
+        assert(chip8.program_counter == 0x206);
+        step(&chip8);
+        assert(chip8.program_counter == 0x20A);
+        assert(key_pressed(&chip8, 7) && !key_pressed(&chip8, 6));
+
+        // Uma tecla já pressionada também conta, mas só ao ser solta
+        chip8.keypad = (1 << 7) | (1 << 0xB);
+        assert(!program_stuck(&chip8));
+        step(&chip8);
+        assert(chip8.program_counter == 0x20A && chip8.key_wait == 7 + 1);
+        assert(program_stuck(&chip8));
+        // Soltar outra tecla não muda a espera
+        chip8.keypad = 1 << 7;
+        step(&chip8);
+        assert(chip8.program_counter == 0x20A);
+
+        savestate_write(&chip8, state);
+        assert(savestate_read(&loaded, state, sizeof(state)));
+        assert(loaded.keypad == 1 << 7 && loaded.key_wait == 7 + 1);
+
+        chip8.keypad = 0;
+        assert(!program_stuck(&chip8));
+        step(&chip8);
+        assert(chip8.program_counter == 0x20C);
+        assert(chip8.registers[1] == 7 && chip8.key_wait == 0);
+}
+
+// Reproduz o filme em `played`, no núcleo threaded, até o fim ou até
+// divergir da gravação
+static MovieStatus play_movie(Movie *movie, Chip8 *played) {
+        set_random_seed(played, movie->seed);
+        set_quirk_profile(played, movie->quirks);
+        load_rom(played, "tests/timendus/6-keypad.ch8");
+        set_instructions_per_tick(played, movie->instructions_per_tick);
+        for (;;) {
+                uint32_t budget = 1000;
+                const MovieStatus status = movie_play(movie, played, &budget);
+                if (status != MOVIE_PLAYING)
+                        return status;
+                assert(run_threaded(played, budget) == budget);
+        }
+}
+
+// Um filme gravado no `step()` reproduz a mesma execução em outro núcleo, e
+// uma entrada diferente é detectada pelos checkpoints
+void test_movie(void) {
+        // Teclado a partir de cada quadro: escolhe o teste de Fx0A no menu e
+        // responde a ele
+        static const struct {
+                uint32_t frame;
+                uint16_t keys;
+        } script[] = {{1000, 1 << 0x3}, {1006, 0}, {2000, 1 << 0x5},
+                      {2007, 0},        {2500, 0}};
+        static Chip8 recorded;
+        static Chip8 played;
+        static Chip8 idle;
+        Movie movie;
+
+        set_random_seed(&recorded, 5);
+        // O perfil vai no filme: reproduzir com outro perfil diverge
+        set_quirk_profile(&recorded, QUIRKS_SCHIP);
+        load_rom(&recorded, "tests/timendus/6-keypad.ch8");
+        set_instructions_per_tick(&recorded, TEST_INSTRUCTIONS_PER_FRAME);
+        idle = recorded;
+        movie_start(&movie, &recorded, 60 * TEST_INSTRUCTIONS_PER_FRAME);
+        size_t next = 0;
+        for (uint32_t frame = 0; frame < 3000; ++frame) {
+                if (next < sizeof(script) / sizeof(script[0]) &&
+                    script[next].frame == frame)
+                        recorded.keypad = script[next++].keys;
+                movie_record(&movie, &recorded);
+                for (uint32_t i = 0; i < TEST_INSTRUCTIONS_PER_FRAME; ++i) {
+                        step(&recorded);
+                        step(&idle);
+                }
+        }
+        movie_finish(&movie, &recorded);
+        // A entrada muda a tela, e as teclas repetidas não viram eventos
+        assert(display_hash(&recorded) != display_hash(&idle));
+        assert(movie.input_count == 5);
+        assert(movie.checkpoint_count == 51);
+        // O arquivo fica fora da árvore do build e é apagado no fim
+        char path[] = "/tmp/c8c-movie-XXXXXX";
+        const int file = mkstemp(path);
+        assert(file >= 0);
+        close(file);
+        assert(movie_save(&movie, path));
+        movie_free(&movie);
+
+        assert(movie_load(&movie, path));
+        assert(movie.end_cycle == recorded.cycle_count);
+        assert(play_movie(&movie, &played) == MOVIE_END);
+        assert_same_state(&recorded, &played);
+        movie_free(&movie);
+
+        assert(movie_load(&movie, path));
+        assert(remove(path) == 0);
+        movie.inputs[2].keys = 1 << 0x6;
+        assert(play_movie(&movie, &played) == MOVIE_DESYNC);
+        movie_free(&movie);
+}
+
+// Laços de espera pulados pelos núcleos terminam no mesmo estado que
+// executados instrução por instrução
+void test_idle_loops(void) {
+        static const uint8_t program[] = {
+            0x60, 0x07, // 200: V0 = 7
+            0xF0, 0x15, // 202: DT = V0
+            0xF1, 0x07, // 204: V1 = DT
+            0x31, 0x00, // 206: pula se V1 == 0
+            0x12, 0x04, // 208: volta para 204
+            0xF0, 0x15, // 20A: DT = V0
+            0xF2, 0x07, // 20C: V2 = DT
+            0x42, 0x00, // 20E: pula se V2 != 0
+            0x12, 0x16, // 210: sai do laço
+            0x12, 0x0C, // 212: volta para 20C
+            0x00, 0x00, // 214
+            0x12, 0x16, // 216: salto para si mesmo
+        };
+        static Chip8 reference;
+        static Chip8 switched;
+        static Chip8 threaded;
+        static Chip8 jit;
+        static JitCache cache;
+        Chip8 *engines[] = {&reference, &switched, &threaded, &jit};
+        for (uint32_t i = 0; i < 4; ++i) {
+                init(engines[i], (uint8_t *)program, sizeof(program));
+                set_instructions_per_tick(engines[i], 10);
+        }
+        jit_attach(&cache, &jit);
+
+        assert(idle_loop_length(&reference) == 0);
+        // Orçamentos que terminam no meio das voltas e dos ticks
+        for (uint32_t budget = 1; reference.program_counter != 0x216;
+             budget = budget % 37 + 5) {
+                for (uint32_t i = 0; i < budget; ++i) {
+                        step(&reference);
+                }
+                assert(run(&switched, budget) == RUN_BUDGET);
+                assert(run_threaded(&threaded, budget) == budget);
+                assert(run_jit(&jit, &cache, budget) == budget);
+                assert_same_state(&reference, &switched);
+                assert_same_state(&reference, &threaded);
+                assert_same_state(&reference, &jit);
+                if (reference.program_counter == 0x20C)
+                        assert(idle_loop_length(&reference) == 3);
+        }
+        assert(idle_loop_length(&reference) == 1);
+        assert(run(&switched, 1000) == RUN_BUDGET);
+        assert(switched.cycle_count == reference.cycle_count + 1000);
+        assert(switched.program_counter == 0x216);
+        jit_detach(&cache, &jit);
+
+        // Bloqueado no Fx0A, só o relógio e os timers andam
+        static const uint8_t wait[] = {0x60, 0x30, 0xF0, 0x15, 0xF3, 0x0A};
+        for (uint32_t i = 0; i < 4; ++i) {
+                init(engines[i], (uint8_t *)wait, sizeof(wait));
+                set_instructions_per_tick(engines[i], 10);
+        }
+        jit_attach(&cache, &jit);
+        assert(!waiting_for_key(&reference));
+        for (uint32_t i = 0; i < 203; ++i) {
+                step(&reference);
+        }
+        assert(waiting_for_key(&reference));
+        assert(run(&switched, 3) == RUN_WAITING_KEY);
+        assert(run_idle_loop(&switched, 200) == 200);
+        assert(run_threaded(&threaded, 203) == 203);
+        assert(run_jit(&jit, &cache, 203) == 203);
+        assert(reference.delay_timer == 0x30 - 20);
+        assert_same_state(&reference, &switched);
+        assert_same_state(&reference, &threaded);
+        assert_same_state(&reference, &jit);
+        jit_detach(&cache, &jit);
+
+        reference.keypad = 1 << 4;
+        assert(!waiting_for_key(&reference));
+        assert(run_idle_loop(&reference, 100) == 0);
+        step(&reference);
+        assert(waiting_for_key(&reference));
+}
+
+// Acessos pelo I dão a volta no fim da memória, em todos os núcleos
+void test_address_wrap(void) {
+        static const uint8_t program[] = {
+            0xAF, 0xFE, // 200: I = FFE
+            0x60, 0x11, // 202: V0 = 11
+            0x61, 0x22, // 204: V1 = 22
+            0x62, 0x33, // 206: V2 = 33
+            0xF2, 0x55, // 208: FFE, FFF e 000 = V0..V2
+            0x60, 0x00, // 20A: V0 = 0
+            0xF2, 0x65, // 20C: V0..V2 = FFE, FFF e 000
+            0xD0, 0x13, // 20E: desenha as 3 linhas em (V0, V1)
+            0x12, 0x10, // 210: laço
+        };
+        static Chip8 reference;
+        static Chip8 cached;
+        static Chip8 threaded;
+        static Chip8 jit;
+        static DecodeCache cache;
+        static JitCache jit_cache;
+        // Sem o incremento do I no Fx55, para reler o mesmo trecho
+        set_quirk_profile(&reference, QUIRKS_SCHIP);
+        set_quirk_profile(&cached, QUIRKS_SCHIP);
+        set_quirk_profile(&threaded, QUIRKS_SCHIP);
+        set_quirk_profile(&jit, QUIRKS_SCHIP);
+        init(&reference, (uint8_t *)program, sizeof(program));
+        init(&cached, (uint8_t *)program, sizeof(program));
+        init(&threaded, (uint8_t *)program, sizeof(program));
+        init(&jit, (uint8_t *)program, sizeof(program));
+        decode_cache_attach(&cache, &cached);
+        jit_attach(&jit_cache, &jit);
+
+        for (uint32_t i = 0; i < 20; ++i) {
+                assert(step(&reference) == FAULT_NONE);
+                assert(step_cached(&cached, &cache) == FAULT_NONE);
+        }
+        assert(run_threaded(&threaded, 20) == 20);
+        assert(run_jit(&jit, &jit_cache, 20) == 20);
+        assert(reference.memory[0xFFE] == 0x11);
+        assert(reference.memory[0xFFF] == 0x22);
+        assert(reference.memory[0x000] == 0x33);
+        assert(reference.registers[0] == 0x11);
+        // A posição inicial dá a volta na tela: y = 0x22 % 32
+        assert(display_pixel(&reference, 0x11 + 3, 2));
+        assert_same_state(&reference, &cached);
+        assert_same_state(&reference, &threaded);
+        assert_same_state(&reference, &jit);
+
+        decode_cache_detach(&cached);
+        jit_detach(&jit_cache, &jit);
+}
+
+// Cada quirk do perfil, no mesmo estado final em todos os núcleos
+void test_quirks(QuirkProfile quirks) {
+        static const uint8_t program[] = {
+            0x6F, 0x07, // 200: VF = 7
+            0x60, 0x05, // 202: V0 = 5
+            0x61, 0x03, // 204: V1 = 3
+            0x80, 0x11, // 206: V0 |= V1, zerando ou não o VF
+            0x83, 0xF0, // 208: V3 = VF
+            0x62, 0x81, // 20A: V2 = 81
+            0x64, 0x01, // 20C: V4 = 1
+            0x84, 0x26, // 20E: V4 = V2 >> 1, ou V4 >>= 1
+            0x66, 0x01, // 210: V6 = 1
+            0x86, 0x2E, // 212: V6 = V2 << 1, ou V6 <<= 1
+            0x87, 0xF0, // 214: V7 = VF
+            0xA3, 0x00, // 216: I = 300
+            0xF1, 0x65, // 218: V0, V1 = 300, 301; I = 302 ou 300
+            0x60, 0x55, // 21A: V0 = 55
+            0xF0, 0x55, // 21C: 302 ou 300 = V0
+            0x60, 0x00, // 21E: V0 = 0
+            0x62, 0x04, // 220: V2 = 4
+            0xB2, 0x28, // 222: salta para 228 + V0 ou 228 + V2
+            0x00, 0x00, // 224
+            0x00, 0x00, // 226
+            0x68, 0x01, // 228: V8 = 1
+            0x12, 0x2E, // 22A: salta para 22E
+            0x68, 0x02, // 22C: V8 = 2
+            0x6A, 0x00, // 22E: VA = 0
+            0xFA, 0x29, // 230: I = caractere "0"
+            0x6C, 0x3E, // 232: VC = 62
+            0x6D, 0x1E, // 234: VD = 30
+            0xDC, 0xD5, // 236: desenha em (62, 30), passando das bordas
+            0x12, 0x38, // 238: laço
+        };
+        static Chip8 reference;
+        static Chip8 cached;
+        static Chip8 threaded;
+        static Chip8 jit;
+        static Chip8 ran;
+        static DecodeCache cache;
+        static JitCache jit_cache;
+        Chip8 *const machines[] = {&reference, &cached, &threaded, &jit,
+                                   &ran};
+        for (size_t i = 0; i < sizeof(machines) / sizeof(machines[0]); ++i) {
+                set_quirk_profile(machines[i], quirks);
+                init(machines[i], (uint8_t *)program, sizeof(program));
+        }
+        decode_cache_attach(&cache, &cached);
+        jit_attach(&jit_cache, &jit);
+
+        const uint32_t cycles = 30;
+        for (uint32_t i = 0; i < cycles; ++i) {
+                assert(step(&reference) == FAULT_NONE);
+                assert(step_cached(&cached, &cache) == FAULT_NONE);
+        }
+        assert(run_threaded(&threaded, cycles) == cycles);
+        assert(run_jit(&jit, &jit_cache, cycles) == cycles);
+        while (ran.cycle_count < cycles) {
+                assert(run(&ran, cycles - ran.cycle_count) != RUN_FAULT);
+        }
+
+        const uint8_t flags = quirk_flags(quirks);
+        const bool vf_reset = flags & QUIRK_VF_RESET;
+        const bool shift_vx = flags & QUIRK_SHIFT_VX;
+        const bool increment = flags & QUIRK_MEMORY_INCREMENT;
+        const bool jump_vx = flags & QUIRK_JUMP_VX;
+        const bool clip = flags & QUIRK_CLIP;
+        assert(reference.registers[3] == (vf_reset ? 0x00 : 0x07));
+        assert(reference.registers[4] == (shift_vx ? 0x00 : 0x40));
+        assert(reference.registers[6] == 0x02);
+        assert(reference.registers[7] == (shift_vx ? 0 : 1));
+        assert(reference.memory[increment ? 0x302 : 0x300] == 0x55);
+        assert(reference.registers[8] == (jump_vx ? 2 : 1));
+        // A primeira linha do "0" passa da borda direita, a terceira passa
+        // da borda de baixo
+        assert(display_pixel(&reference, 63, 30));
+        assert(display_pixel(&reference, 1, 30) == !clip);
+        assert(display_pixel(&reference, 62, 0) == !clip);
+        for (size_t i = 1; i < sizeof(machines) / sizeof(machines[0]); ++i) {
+                assert_same_state(&reference, machines[i]);
+        }
+
+        decode_cache_detach(&cached);
+        jit_detach(&jit_cache, &jit);
+}
+
+// Alta resolução, sprite 16x16, rolagens, flags RPL e fonte grande, no
+// mesmo estado final em todos os núcleos
+void test_superchip(void) {
+        static const uint8_t program[] = {
+            0x00, 0xFF, // 200: alta resolução
+            0x60, 0x3C, // 202: V0 = 60
+            0x61, 0x00, // 204: V1 = 0
+            0xA2, 0x40, // 206: I = 240
+            0xD0, 0x10, // 208: 16x16 em (60, 0), atravessando as palavras
+            0x00, 0xC2, // 20A: rola 2 linhas para baixo
+            0x00, 0xFB, // 20C: rola 4 pixels para a direita
+            0x00, 0xFC, // 20E: e 8 para a esquerda
+            0x00, 0xFC, // 210
+            0x60, 0xA1, // 212: V0 = A1
+            0x61, 0xB2, // 214: V1 = B2
+            0xF1, 0x75, // 216: flags RPL = V0, V1
+            0x60, 0x00, // 218: V0 = 0
+            0x61, 0x00, // 21A: V1 = 0
+            0xF1, 0x85, // 21C: V0, V1 = flags RPL
+            0x62, 0x08, // 21E: V2 = 8
+            0xF2, 0x30, // 220: I = "8" grande
+            0x00, 0xFD, // 222: sai
+            [0x40 ... 0x5F] = 0xFF, // 240: sprite 16x16 cheio
+        };
+        static Chip8 reference;
+        static Chip8 cached;
+        static Chip8 threaded;
+        static Chip8 jit;
+        static Chip8 ran;
+        static Chip8 loaded;
+        static DecodeCache cache;
+        static JitCache jit_cache;
+        Chip8 *const machines[] = {&reference, &cached, &threaded, &jit,
+                                   &ran};
+        for (size_t i = 0; i < sizeof(machines) / sizeof(machines[0]); ++i) {
+                set_quirk_profile(machines[i], QUIRKS_SCHIP);
+                init(machines[i], (uint8_t *)program, sizeof(program));
+        }
+        decode_cache_attach(&cache, &cached);
+        jit_attach(&jit_cache, &jit);
+
+        const uint32_t cycles = 30;
+        for (uint32_t i = 0; i < cycles; ++i) {
+                assert(step(&reference) == FAULT_NONE);
+                assert(step_cached(&cached, &cache) == FAULT_NONE);
+        }
+        assert(run_threaded(&threaded, cycles) == cycles);
+        assert(run_jit(&jit, &jit_cache, cycles) == cycles);
+        while (ran.cycle_count < cycles) {
+                assert(run(&ran, cycles - ran.cycle_count) != RUN_FAULT);
+        }
+
+        assert(reference.hires);
+        assert(reference.registers[0xF] == 0);
+        // O bloco foi para as linhas 2 a 17 e as colunas 56 a 71
+        assert(display_pixel(&reference, 56, 2));
+        assert(display_pixel(&reference, 71, 17));
+        assert(!display_pixel(&reference, 55, 2));
+        assert(!display_pixel(&reference, 72, 2));
+        assert(!display_pixel(&reference, 56, 1));
+        assert(!display_pixel(&reference, 56, 18));
+        assert(reference.registers[0] == 0xA1);
+        assert(reference.registers[1] == 0xB2);
+        assert(reference.index_register ==
+               BIG_FONTSET_START + 8 * BIG_FONT_SPRITE_SIZE);
+        // O 00FD não sai do lugar
+        assert(reference.program_counter == 0x222);
+        assert(program_stuck(&reference));
+        for (size_t i = 1; i < sizeof(machines) / sizeof(machines[0]); ++i) {
+                assert_same_state(&reference, machines[i]);
+        }
+
+        // Resolução e flags RPL passam pelo estado salvo, e as flags
+        // sobrevivem ao `reset()`
+        static uint8_t buffer[SAVESTATE_SIZE];
+        savestate_write(&reference, buffer);
+        assert(savestate_read(&loaded, buffer, sizeof(buffer)));
+        assert(loaded.hires);
+        assert_same_state(&reference, &loaded);
+        reset(&loaded);
+        assert(!loaded.hires);
+        assert(loaded.rpl_flags[1] == 0xB2);
+
+        // Em baixa resolução, a rolagem não passa para a segunda palavra
+        set_hires(&loaded, false);
+        loaded.display[0][0] = 1;
+        scroll_right(&loaded);
+        assert(loaded.display[0][0] == 0 && loaded.display[0][1] == 0);
+        loaded.display[LORES_HEIGHT - 1][0] = 1;
+        scroll_down(&loaded, 1);
+        assert(loaded.display[LORES_HEIGHT][0] == 0);
+
+        decode_cache_detach(&cached);
+        jit_detach(&jit_cache, &jit);
+}